@@ -0,0 +1,396 @@
+// Prediction-path latency: cold start, steady-state percentiles per batch size and an
+// open-loop load generator.
+//
+//   bench_infer --model PATH [--cold-runs N] [--batches 1,2,4,...] [--seconds S]
+//               [--qps 1000,5000,..] [--duration S] [--threads N] [--batching]
+//               [--max-wait-us N] [--json FILE|-]
+//
+// PATH is a CSV model directory or a .mnm file and is required: the checked-in
+// nn-models/nnv1_96 predates the weights_N.csv layout (no weights_0.csv, and weights_3.csv
+// does not match its descriptor), so load() rejects it. Train a model with ./bin/mnist, which
+// saves it to testing/, and optionally convert it with convert_model. Cold start is
+// open_model() plus the first single-sample run(), repeated --cold-runs times (the first
+// run may include reading the files from disk, the rest hit the page cache).
+//
+// Without --qps every batch size is run back to back for --seconds (at least 20 calls) and the
+// table reports per-call latency percentiles and the per-sample cost they imply; p999 needs
+// about 1000 calls to mean more than the maximum.
+//
+// With --qps each target rate is offered for --duration seconds by --threads generator
+// threads. Arrivals are scheduled up front (open loop): latency runs from a request's
+// scheduled time to its answer, so time spent waiting behind a saturated model counts.
+// Arrivals still unserved at twice --duration are dropped and reported.
+// Requests go straight to InferenceModel::run(), or through a BatchingPredictor with
+// --batching; batched requests are submitted without blocking the generator, so as many as
+// the rate implies can be waiting to be coalesced.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Infer/batching_predictor.h"
+#include "Infer/model_watcher.h"
+#include "bench_util.h"
+
+namespace {
+
+struct Options {
+    std::string model;  // required
+    int cold_runs = 5;
+    std::vector<int> batches = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
+    double seconds = 0.5;
+    std::vector<int> qps;
+    double duration = 5.0;
+    int threads = 8;
+    bool batching = false;
+    int max_wait_us = 200;
+    std::string json_path;
+};
+
+bool parse_args(int argc, char* argv[], Options& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--model" && has_value) {
+            opts.model = argv[++i];
+        } else if (arg == "--cold-runs" && has_value) {
+            opts.cold_runs = std::atoi(argv[++i]);
+        } else if (arg == "--batches" && has_value) {
+            opts.batches = bench::parse_list(argv[++i]);
+        } else if (arg == "--seconds" && has_value) {
+            opts.seconds = std::atof(argv[++i]);
+        } else if (arg == "--qps" && has_value) {
+            opts.qps = bench::parse_list(argv[++i]);
+        } else if (arg == "--duration" && has_value) {
+            opts.duration = std::atof(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            opts.threads = std::atoi(argv[++i]);
+        } else if (arg == "--batching") {
+            opts.batching = true;
+        } else if (arg == "--max-wait-us" && has_value) {
+            opts.max_wait_us = std::atoi(argv[++i]);
+        } else if (arg == "--json" && has_value) {
+            opts.json_path = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    for (int b : opts.batches)
+        if (b <= 0) return false;
+    for (int q : opts.qps)
+        if (q <= 0) return false;
+    return !opts.model.empty() && opts.cold_runs > 0 && opts.threads > 0 &&
+           !opts.batches.empty();
+}
+
+std::vector<float> random_inputs(int n, int size) {
+    std::vector<float> x((size_t)n * size);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (auto& v : x) v = dist(rng);
+    return x;
+}
+
+// latencies in seconds -> {"p50_us":..,"p99_us":..,"p999_us":..,"max_us":..}
+bench::JsonObject latency_json(const std::vector<double>& lat) {
+    return bench::JsonObject()
+        .add("p50_us", 1e6 * bench::percentile(lat, 0.5))
+        .add("p99_us", 1e6 * bench::percentile(lat, 0.99))
+        .add("p999_us", 1e6 * bench::percentile(lat, 0.999))
+        .add("max_us", 1e6 * bench::percentile(lat, 1.0));
+}
+
+// ---------------------------------------------------------------
+// Cold start
+// ---------------------------------------------------------------
+
+std::string cold_start(const Options& opts, int max_batch, std::ostream& out) {
+    std::vector<double> load, first;
+    for (int r = 0; r < opts.cold_runs; r++) {
+        auto start = bench::Clock::now();
+        auto model = open_model(opts.model, max_batch, opts.threads);
+        if (!model) return "";
+        load.push_back(bench::seconds_since(start));
+
+        auto x = random_inputs(1, model->input_size());
+        std::vector<float> y(model->output_size());
+        start = bench::Clock::now();
+        model->run(x.data(), 1, y.data());
+        first.push_back(bench::seconds_since(start));
+    }
+
+    out << std::fixed << std::setprecision(3) << "Cold start over " << opts.cold_runs
+        << " runs: load " << 1e3 * load[0] << " ms first, " << 1e3 * bench::percentile(load, 0.5)
+        << " ms median; first prediction " << 1e6 * bench::percentile(first, 0.5)
+        << " us median\n\n"
+        << std::defaultfloat;
+
+    return bench::JsonObject()
+        .add("runs", opts.cold_runs)
+        .add("load_first_ms", 1e3 * load[0])
+        .add("load_median_ms", 1e3 * bench::percentile(load, 0.5))
+        .add("first_predict_median_us", 1e6 * bench::percentile(first, 0.5))
+        .add("total_median_ms",
+             1e3 * (bench::percentile(load, 0.5) + bench::percentile(first, 0.5)))
+        .str();
+}
+
+// ---------------------------------------------------------------
+// Steady-state latency per batch size
+// ---------------------------------------------------------------
+
+std::string latency_sweep(const Options& opts, const InferenceModel& model, std::ostream& out) {
+    int max_batch = *std::max_element(opts.batches.begin(), opts.batches.end());
+    auto x = random_inputs(max_batch, model.input_size());
+    std::vector<float> y((size_t)max_batch * model.output_size());
+
+    out << std::right << std::setw(6) << "batch" << std::setw(9) << "calls" << std::setw(11)
+        << "p50 us" << std::setw(11) << "p99 us" << std::setw(11) << "p999 us" << std::setw(14)
+        << "us/sample" << std::setw(13) << "samples/s" << "\n";
+
+    std::vector<std::string> rows;
+    for (int batch : opts.batches) {
+        for (int i = 0; i < 3; i++) model.run(x.data(), batch, y.data());  // warm-up
+
+        std::vector<double> lat;
+        auto start = bench::Clock::now();
+        while (lat.size() < 20 || bench::seconds_since(start) < opts.seconds) {
+            auto t = bench::Clock::now();
+            model.run(x.data(), batch, y.data());
+            lat.push_back(bench::seconds_since(t));
+        }
+        double total = bench::seconds_since(start);
+        double p50 = bench::percentile(lat, 0.5);
+        double rate = (double)lat.size() * batch / total;
+
+        out << std::setw(6) << batch << std::setw(9) << lat.size() << std::fixed
+            << std::setprecision(1) << std::setw(11) << 1e6 * p50 << std::setw(11)
+            << 1e6 * bench::percentile(lat, 0.99) << std::setw(11)
+            << 1e6 * bench::percentile(lat, 0.999) << std::setprecision(3) << std::setw(14)
+            << 1e6 * p50 / batch << std::setprecision(0) << std::setw(13) << rate << "\n"
+            << std::defaultfloat;
+
+        rows.push_back(latency_json(lat)
+                           .add("batch", batch)
+                           .add("calls", (double)lat.size())
+                           .add("per_sample_us", 1e6 * p50 / batch)
+                           .add("samples_per_sec", rate)
+                           .str());
+    }
+    out << "\n";
+    return bench::json_array(rows);
+}
+
+// ---------------------------------------------------------------
+// Open-loop load generator
+// ---------------------------------------------------------------
+
+struct LoadResult {
+    std::vector<double> latency;  // seconds from scheduled arrival to answer
+    double seconds = 0.0;         // first arrival to last answer
+    long dropped = 0;             // arrivals not served before the cut-off
+};
+
+LoadResult offer_load(const Options& opts, const std::shared_ptr<const InferenceModel>& model,
+                      BatchingPredictor* batcher, int qps) {
+    const long total = std::max<long>(1, (long)(qps * opts.duration));
+    const auto interval = std::chrono::duration<double>(1.0 / qps);
+    const int in = model->input_size();
+    const int classes = model->output_size();
+    auto x = random_inputs(64, in);
+    auto t0 = bench::Clock::now() + std::chrono::milliseconds(10);
+
+    // the last slot belongs to the collector of batched requests
+    std::vector<std::vector<double>> latency(opts.threads + 1);
+    std::vector<bench::Clock::time_point> done(opts.threads + 1, t0);
+    std::atomic<long> dropped{0};
+    auto cutoff = t0 + std::chrono::duration_cast<bench::Clock::duration>(
+                           std::chrono::duration<double>(2.0 * opts.duration));
+
+    // Batched requests are submitted without waiting for the answer, otherwise each generator
+    // thread would have at most one request in flight and batches could never grow past
+    // --threads. One collector takes the futures in arrival order.
+    struct Pending {
+        bench::Clock::time_point due;
+        std::future<std::vector<float>> result;
+    };
+    std::deque<Pending> pending;
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    int generating = opts.threads;
+
+    std::thread collector;
+    if (batcher) {
+        collector = std::thread([&] {
+            auto& lat = latency[opts.threads];
+            for (;;) {
+                Pending p;
+                {
+                    std::unique_lock<std::mutex> lock(pending_mutex);
+                    pending_cv.wait(lock, [&] { return !pending.empty() || generating == 0; });
+                    if (pending.empty()) return;
+                    p = std::move(pending.front());
+                    pending.pop_front();
+                }
+                p.result.get();
+                auto now = bench::Clock::now();
+                lat.push_back(std::chrono::duration<double>(now - p.due).count());
+                done[opts.threads] = now;
+            }
+        });
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opts.threads; t++) {
+        threads.emplace_back([&, t] {
+            std::vector<float> y(classes);
+            auto& lat = latency[t];
+            lat.reserve(total / opts.threads + 1);
+
+            // thread t issues arrivals t, t + threads, ...; a busy thread falls behind its
+            // schedule rather than skipping, and the delay shows up in the latency
+            for (long k = t; k < total; k += opts.threads) {
+                if (bench::Clock::now() >= cutoff) {
+                    dropped += (total - 1 - k) / opts.threads + 1;
+                    break;
+                }
+                auto due =
+                    t0 + std::chrono::duration_cast<bench::Clock::duration>(interval * (double)k);
+                std::this_thread::sleep_until(due);
+
+                const float* sample = x.data() + (size_t)(k % 64) * in;
+                if (batcher) {
+                    auto result = batcher->predict(sample);
+                    std::lock_guard<std::mutex> lock(pending_mutex);
+                    pending.push_back(Pending{due, std::move(result)});
+                    pending_cv.notify_one();
+                    continue;
+                }
+                model->run(sample, 1, y.data());
+
+                auto now = bench::Clock::now();
+                lat.push_back(std::chrono::duration<double>(now - due).count());
+                done[t] = now;
+            }
+
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            generating--;
+            pending_cv.notify_one();
+        });
+    }
+    for (auto& th : threads) th.join();
+    if (collector.joinable()) collector.join();
+
+    LoadResult r;
+    for (auto& lat : latency) r.latency.insert(r.latency.end(), lat.begin(), lat.end());
+    auto last = *std::max_element(done.begin(), done.end());
+    r.seconds = std::chrono::duration<double>(last - t0).count();
+    r.dropped = dropped;
+    return r;
+}
+
+std::string load_test(const Options& opts, const std::shared_ptr<const InferenceModel>& model,
+                      std::ostream& out) {
+    std::unique_ptr<BatchingPredictor> batcher;
+    if (opts.batching) {
+        BatchingOptions bo;
+        bo.max_wait = std::chrono::microseconds(opts.max_wait_us);
+        bo.threads = std::max(1, std::min(opts.threads, (int)std::thread::hardware_concurrency()));
+        batcher = std::make_unique<BatchingPredictor>(model, bo);
+    }
+
+    out << "Open-loop load, " << opts.threads << " threads, " << opts.duration << " s per rate, "
+        << (batcher ? "batched (max_wait " + std::to_string(opts.max_wait_us) + " us)"
+                    : std::string("direct run()"))
+        << "\n";
+    out << std::right << std::setw(10) << "target" << std::setw(11) << "achieved" << std::setw(11)
+        << "p50 us" << std::setw(11) << "p99 us" << std::setw(11) << "p999 us" << std::setw(12)
+        << "max us" << std::setw(10) << "dropped" << (batcher ? "  mean batch" : "") << "\n";
+
+    std::vector<std::string> rows;
+    for (int qps : opts.qps) {
+        long batches = batcher ? batcher->batches() : 0;
+        long requests = batcher ? batcher->requests() : 0;
+        LoadResult r = offer_load(opts, model, batcher.get(), qps);
+        double achieved = r.latency.size() / r.seconds;
+        double mean_batch = 1.0;
+        if (batcher && batcher->batches() > batches)
+            mean_batch = (double)(batcher->requests() - requests) / (batcher->batches() - batches);
+
+        out << std::fixed << std::setprecision(0) << std::setw(10) << (double)qps << std::setw(11)
+            << achieved << std::setprecision(1) << std::setw(11)
+            << 1e6 * bench::percentile(r.latency, 0.5) << std::setw(11)
+            << 1e6 * bench::percentile(r.latency, 0.99) << std::setw(11)
+            << 1e6 * bench::percentile(r.latency, 0.999) << std::setw(12)
+            << 1e6 * bench::percentile(r.latency, 1.0) << std::setw(10) << r.dropped;
+        if (batcher) out << std::setw(12) << mean_batch;
+        out << "\n" << std::defaultfloat;
+
+        rows.push_back(latency_json(r.latency)
+                           .add("target_qps", qps)
+                           .add("achieved_qps", achieved)
+                           .add("requests", (double)r.latency.size())
+                           .add("dropped", (double)r.dropped)
+                           .add("mean_batch", mean_batch)
+                           .str());
+    }
+    if (batcher) batcher->print_stats(out);
+    out << "\n";
+    return bench::json_array(rows);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    if (!parse_args(argc, argv, opts)) {
+        std::cerr << "usage: bench_infer --model PATH [--cold-runs N] [--batches 1,2,4,...] "
+                     "[--seconds S] [--qps 1000,5000,..] [--duration S] [--threads N] "
+                     "[--batching] [--max-wait-us N] [--json FILE|-]\n"
+                     "PATH is a CSV model directory or a .mnm file. nn-models/nnv1_96 cannot be "
+                     "loaded as checked in\n(it has no weights_0.csv); train a model with "
+                     "./bin/mnist (saved to testing/) or fix and convert nnv1_96 first.\n";
+        return 1;
+    }
+    std::ostream& out = opts.json_path == "-" ? std::cerr : std::cout;
+
+    int max_batch = *std::max_element(opts.batches.begin(), opts.batches.end());
+    std::string cold = cold_start(opts, max_batch, out);
+    if (cold.empty()) {
+        std::cerr << "Cannot load model " << opts.model << "\n";
+        return 1;
+    }
+
+    std::shared_ptr<const InferenceModel> model = open_model(opts.model, max_batch, opts.threads);
+    if (!model) return 1;
+
+    bench::JsonObject json;
+    json.add("benchmark", "bench_infer")
+        .add("timestamp", bench::timestamp())
+        .add("model", opts.model)
+        .raw("cold_start", cold);
+
+    if (opts.qps.empty())
+        json.raw("latency", latency_sweep(opts, *model, out));
+    else
+        json.add("batching", opts.batching ? "on" : "off")
+            .add("threads", opts.threads)
+            .raw("load", load_test(opts, model, out));
+
+    if (!opts.json_path.empty() && !bench::write_file(opts.json_path, json.str() + "\n")) {
+        std::cerr << "Failed to write " << opts.json_path << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Micro-benchmarks of the CPU tensor kernels at the shapes the network uses.
+//
+//   bench_tensor [--layers 784,512,256,10] [--batches 1,64,256] [--trials N] [--warmup N]
+//                [--filter SUBSTR] [--json FILE|-]
+//
+// Every case is warmed up, then timed over N trials; the table reports the median and p95
+// time per call with the GFLOP/s and GB/s they imply (bytes = minimal traffic: every input
+// read once, every output written once). --json writes the same results for tracking.
+
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "NN/neural_network.h"
+#include "Tensor/tensor.h"
+#include "bench_util.h"
+
+namespace {
+
+struct Case {
+    std::string op;
+    std::string shape;
+    double flops;
+    double bytes;
+    std::function<void()> fn;
+};
+
+std::string dims(int r, int c) { return std::to_string(r) + "x" + std::to_string(c); }
+
+std::shared_ptr<Tensor> random_tensor(int r, int c, std::mt19937& rng) {
+    auto t = std::make_shared<Tensor>(r, c);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (int i = 0; i < t->size(); i++) t->h_data[i] = dist(rng);
+    return t;
+}
+
+// (m x k) * (k x n)
+void add_matmul(std::vector<Case>& cases, const std::string& op, int m, int k, int n,
+                std::mt19937& rng) {
+    auto A = random_tensor(m, k, rng);
+    auto B = random_tensor(k, n, rng);
+    cases.push_back({op, dims(m, k) + "*" + dims(k, n), 2.0 * m * n * k,
+                     4.0 * ((double)m * k + (double)k * n + (double)m * n),
+                     [A, B] { Tmatmul(*A, *B); }});
+}
+
+// the elementwise ops on one (r x c) operand shape
+void add_elementwise(std::vector<Case>& cases, int r, int c, std::mt19937& rng) {
+    auto a = random_tensor(r, c, rng);
+    auto b = random_tensor(r, c, rng);
+    auto scratch = random_tensor(r, c, rng);
+    double n = (double)r * c;
+    std::string shape = dims(r, c);
+
+    cases.push_back({"Tadd", shape, n, 12 * n, [a, b] { Tadd(*a, *b); }});
+    cases.push_back({"Tsub", shape, n, 12 * n, [a, b] { Tsub(*a, *b); }});
+    cases.push_back({"Tmul", shape, n, 12 * n, [a, b] { Tmul(*a, *b); }});
+    cases.push_back({"TmulScalar", shape, n, 8 * n, [a] { TmulScalar(*a, 0.5f); }});
+    cases.push_back({"TaddScalar", shape, n, 8 * n, [a] { TaddScalar(*a, 0.5f); }});
+    cases.push_back({"TSigmoid", shape, 4 * n, 8 * n, [a] { TSigmoid(*a); }});
+    // in place: relu / relu' of relu'd data is a fixed point, so every call does the same work
+    cases.push_back({"TRelu", shape, n, 8 * n, [scratch] { TRelu(*scratch); }});
+    cases.push_back({"TReluPrime", shape, n, 8 * n, [scratch] { TReluPrime(*scratch); }});
+}
+
+std::vector<Case> build_cases(const std::vector<int>& layers, const std::vector<int>& batches) {
+    std::mt19937 rng(42);
+    std::vector<Case> cases;
+
+    for (size_t l = 0; l + 1 < layers.size(); l++) {
+        int in = layers[l];
+        int out = layers[l + 1];
+
+        // batch independent: weight transpose (backprop) and the parameter update shapes
+        auto W = random_tensor(out, in, rng);
+        cases.push_back({"Ttranspose", dims(out, in), 0.0, 8.0 * out * in,
+                         [W] { Ttranspose(*W); }});
+        add_elementwise(cases, out, in, rng);
+
+        for (int B : batches) {
+            // forward W*A, weight gradient dZ*A^T, input gradient W^T*dZ
+            add_matmul(cases, "Tmatmul", out, in, B, rng);
+            add_matmul(cases, "Tmatmul", out, B, in, rng);
+            add_matmul(cases, "Tmatmul", in, out, B, rng);
+
+            auto Z = random_tensor(out, B, rng);
+            auto bias = random_tensor(out, 1, rng);
+            double n = (double)out * B;
+            cases.push_back({"TaddBias", dims(out, B) + "+" + dims(out, 1), n, 8 * n + 4 * out,
+                             [Z, bias] { TaddBias(*Z, *bias); }});
+            cases.push_back({"TsumCols", dims(out, B), n, 4 * n + 4 * out,
+                             [Z] { TsumCols(*Z); }});
+
+            auto A = random_tensor(in, B, rng);
+            cases.push_back({"Ttranspose", dims(in, B), 0.0, 8.0 * in * B,
+                             [A] { Ttranspose(*A); }});
+
+            if (l + 2 == layers.size()) {
+                // softmax of probabilities stays finite, so repeating it in place is fine
+                auto P = random_tensor(out, B, rng);
+                cases.push_back({"TSoftmaxCols", dims(out, B), 4 * n, 8 * n,
+                                 [P] { TSoftmaxCols(*P); }});
+            } else {
+                add_elementwise(cases, out, B, rng);
+            }
+        }
+    }
+    return cases;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<int> layers = {784, 512, 256, 10};
+    std::vector<int> batches = {1, 64, 256};
+    int trials = 15;
+    int warmup = 2;
+    std::string filter;
+    std::string json_path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--layers" && has_value) {
+            layers = bench::parse_list(argv[++i]);
+        } else if (arg == "--batches" && has_value) {
+            batches = bench::parse_list(argv[++i]);
+        } else if (arg == "--trials" && has_value) {
+            trials = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--filter" && has_value) {
+            filter = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            json_path = argv[++i];
+        } else {
+            std::cerr << "usage: bench_tensor [--layers 784,512,256,10] [--batches 1,64,256] "
+                         "[--trials N] [--warmup N] [--filter SUBSTR] [--json FILE|-]\n";
+            return 1;
+        }
+    }
+
+    std::vector<Case> cases = build_cases(layers, batches);
+
+    // the table goes to stderr when the JSON takes stdout
+    std::ostream& out = json_path == "-" ? std::cerr : std::cout;
+    out << std::left << std::setw(13) << "op" << std::setw(22) << "shape" << std::right
+        << std::setw(12) << "median us" << std::setw(12) << "p95 us" << std::setw(10)
+        << "GFLOP/s" << std::setw(9) << "GB/s" << "\n";
+
+    std::vector<std::string> results;
+    for (const Case& c : cases) {
+        if (!filter.empty() && (c.op + " " + c.shape).find(filter) == std::string::npos)
+            continue;
+
+        bench::Timing t = bench::time_it(c.fn, warmup, trials);
+        double gflops = c.flops / t.median / 1e9;
+        double gbs = c.bytes / t.median / 1e9;
+
+        out << std::left << std::setw(13) << c.op << std::setw(22) << c.shape << std::right
+            << std::fixed << std::setprecision(2) << std::setw(12) << t.median * 1e6
+            << std::setw(12) << t.p95 * 1e6 << std::setw(10) << gflops << std::setw(9) << gbs
+            << std::defaultfloat << "\n";
+
+        results.push_back(bench::JsonObject()
+                              .add("op", c.op)
+                              .add("shape", c.shape)
+                              .add("median_us", t.median * 1e6)
+                              .add("p95_us", t.p95 * 1e6)
+                              .add("min_us", t.min * 1e6)
+                              .add("gflops", gflops)
+                              .add("gbps", gbs)
+                              .add("trials", t.trials)
+                              .add("calls_per_trial", t.calls_per_trial)
+                              .str());
+    }
+
+    if (!json_path.empty()) {
+        std::string json = bench::JsonObject()
+                               .add("benchmark", "bench_tensor")
+                               .add("timestamp", bench::timestamp())
+                               .raw("results", bench::json_array(results))
+                               .str() +
+                           "\n";
+        if (!bench::write_file(json_path, json)) {
+            std::cerr << "Failed to write " << json_path << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,294 @@
+// End-to-end training throughput with a per-phase breakdown.
+//
+//   bench_train [--layers 784,512,256,10] [--batch N] [--steps N] [--warmup-steps N]
+//               [--data CSV] [--samples N] [--val-every N] [--val-samples N]
+//               [--checkpoint-every N] [--json FILE|-] [--baseline FILE] [--threshold F]
+//
+// Runs the same steps as Train_batch_imgs (shuffle, stack, forward, backward, update) on
+// synthetic images, or on a CSV through the dataset cache with --data, plus periodic
+// validation and checkpoints through a CheckpointWriter as main.cpp does. Reports samples/s
+// and the time of every phase.
+//
+// With --baseline FILE (JSON written earlier by --json with the same layers, batch, steps,
+// data, --val-every, --val-samples and --checkpoint-every) the exit code is 2 when samples/s
+// drops more than --threshold (default 0.10) below it.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Data/dataset.h"
+#include "NN/checkpoint_writer.h"
+#include "NN/neural_network.h"
+#include "bench_util.h"
+
+namespace {
+
+enum Phase { SHUFFLE, STACK, FORWARD, BACKWARD, UPDATE, VALIDATE, CHECKPOINT, NUM_PHASES };
+const char* PHASE_NAMES[NUM_PHASES] = {"shuffle",  "stack",    "forward",   "backward",
+                                       "update",   "validate", "checkpoint"};
+
+struct Options {
+    std::vector<int> layers = {784, 512, 256, 10};
+    int batch = 64;
+    int steps = 200;
+    int warmup_steps = 5;
+    std::string data;
+    int samples = 10000;
+    int val_every = 100;
+    int val_samples = 1000;
+    int checkpoint_every = 100;
+    std::string json_path;
+    std::string baseline;
+    double threshold = 0.10;
+};
+
+bool parse_args(int argc, char* argv[], Options& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--layers" && has_value) {
+            opts.layers = bench::parse_list(argv[++i]);
+        } else if (arg == "--batch" && has_value) {
+            opts.batch = std::atoi(argv[++i]);
+        } else if (arg == "--steps" && has_value) {
+            opts.steps = std::atoi(argv[++i]);
+        } else if (arg == "--warmup-steps" && has_value) {
+            opts.warmup_steps = std::atoi(argv[++i]);
+        } else if (arg == "--data" && has_value) {
+            opts.data = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            opts.samples = std::atoi(argv[++i]);
+        } else if (arg == "--val-every" && has_value) {
+            opts.val_every = std::atoi(argv[++i]);
+        } else if (arg == "--val-samples" && has_value) {
+            opts.val_samples = std::atoi(argv[++i]);
+        } else if (arg == "--checkpoint-every" && has_value) {
+            opts.checkpoint_every = std::atoi(argv[++i]);
+        } else if (arg == "--json" && has_value) {
+            opts.json_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            opts.baseline = argv[++i];
+        } else if (arg == "--threshold" && has_value) {
+            opts.threshold = std::atof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return opts.layers.size() >= 2 && opts.batch > 0 && opts.steps > 0 && opts.samples > 0;
+}
+
+// random pixels and labels, `n` images of layers[0] pixels
+std::unique_ptr<Dataset> synthetic(int pixels, int classes, int n) {
+    auto ds = std::make_unique<Dataset>(pixels, 1);
+    std::mt19937 rng(7);
+    std::vector<uint8_t> img(pixels);
+    for (int i = 0; i < n; i++) {
+        for (auto& p : img) p = rng() % 256;
+        ds->add(img.data(), (int)(rng() % classes));
+    }
+    return ds;
+}
+
+// value of "key": <number> in a flat JSON file, NaN if missing
+double json_value(const std::string& text, const std::string& key) {
+    size_t pos = text.find("\"" + key + "\"");
+    if (pos == std::string::npos) return std::nan("");
+    pos = text.find(':', pos);
+    return pos == std::string::npos ? std::nan("") : std::atof(text.c_str() + pos + 1);
+}
+
+std::string json_text(const std::string& text, const std::string& key) {
+    size_t pos = text.find("\"" + key + "\"");
+    if (pos == std::string::npos) return "";
+    size_t open = text.find('"', text.find(':', pos));
+    size_t close = text.find('"', open + 1);
+    return open == std::string::npos || close == std::string::npos
+               ? ""
+               : text.substr(open + 1, close - open - 1);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    if (!parse_args(argc, argv, opts)) {
+        std::cerr << "usage: bench_train [--layers 784,512,256,10] [--batch N] [--steps N] "
+                     "[--warmup-steps N] [--data CSV] [--samples N] [--val-every N] "
+                     "[--val-samples N] [--checkpoint-every N] [--json FILE|-] "
+                     "[--baseline FILE] [--threshold F]\n";
+        return 1;
+    }
+
+    const int inputs = opts.layers.front();
+    const int classes = opts.layers.back();
+
+    std::unique_ptr<Dataset> train;
+    if (!opts.data.empty()) {
+        train = Dataset::from_csv(opts.data, opts.samples);
+        if (!train || train->empty() || train->pixels() != inputs) {
+            std::cerr << "No usable samples with " << inputs << " pixels in " << opts.data
+                      << "\n";
+            return 1;
+        }
+    } else {
+        train = synthetic(inputs, classes, opts.samples);
+    }
+    const int total = train->size();
+
+    std::unique_ptr<NeuralNetwork> net(new NeuralNetwork(opts.layers, 0.01f));
+    TrainState state;
+    CheckpointWriter checkpoints(net.get(), 3, false);
+    const std::string checkpoint_path = "/tmp/bench_train-" + std::to_string(getpid()) + ".bin";
+
+    double phase[NUM_PHASES] = {};
+    int pos = total;   // forces a shuffle on the first step
+    long trained = 0;  // samples of the timed steps; a step is short when --samples < --batch
+
+    auto step = [&](bool timed) {
+        auto t = bench::Clock::now();
+        auto lap = [&](Phase p) {
+            auto now = bench::Clock::now();
+            if (timed) phase[p] += std::chrono::duration<double>(now - t).count();
+            t = now;
+        };
+
+        if (pos + opts.batch > total) {
+            if ((int)state.order.size() != total) state.reset_order(total);
+            std::shuffle(state.order.begin(), state.order.end(), state.rng);
+            pos = 0;
+        }
+        lap(SHUFFLE);
+
+        int bs = std::min(opts.batch, total - pos);
+        auto X = stack_batch_inputs(*train, state.order, pos, bs);
+        auto Y = stack_batch_labels(*train, state.order, pos, bs);
+        pos += bs;
+        if (timed) trained += bs;
+        lap(STACK);
+
+        auto cache = forward_pass_batch(net.get(), X.get());
+        lap(FORWARD);
+        auto grads = backward_pass_batch(net.get(), cache, Y.get());
+        lap(BACKWARD);
+        update_params(net.get(), grads);
+        state.step++;
+        lap(UPDATE);
+    };
+
+    for (int i = 0; i < opts.warmup_steps; i++) step(false);
+
+    auto start = bench::Clock::now();
+    for (int i = 1; i <= opts.steps; i++) {
+        step(true);
+
+        if (opts.val_every > 0 && i % opts.val_every == 0) {
+            auto t = bench::Clock::now();
+            evaluate_accuracy(net.get(), *train, opts.val_samples);
+            phase[VALIDATE] += bench::seconds_since(t);
+        }
+        if (opts.checkpoint_every > 0 && i % opts.checkpoint_every == 0) {
+            auto t = bench::Clock::now();
+            checkpoints.save_checkpoint(net.get(), state, {}, checkpoint_path);
+            phase[CHECKPOINT] += bench::seconds_since(t);
+        }
+    }
+    double seconds = bench::seconds_since(start);
+    checkpoints.flush();
+    std::remove(checkpoint_path.c_str());
+
+    double samples_per_sec = trained / seconds;
+
+    // ---------------------------------------------------------------
+    // Report
+    // ---------------------------------------------------------------
+    std::ostream& out = opts.json_path == "-" ? std::cerr : std::cout;
+    out << "Layers " << bench::layers_string(opts.layers) << ", batch " << opts.batch << ", "
+        << opts.steps << " steps on " << total << (opts.data.empty() ? " synthetic" : "")
+        << " samples\n";
+    out << std::fixed << std::setprecision(1) << samples_per_sec << " samples/s ("
+        << std::setprecision(3) << seconds << " s)\n\n";
+
+    out << std::left << std::setw(12) << "phase" << std::right << std::setw(10) << "seconds"
+        << std::setw(8) << "%" << std::setw(12) << "ms/step" << "\n";
+
+    double other = seconds;
+    std::vector<std::string> phases;
+    for (int p = 0; p < NUM_PHASES; p++) {
+        other -= phase[p];
+        out << std::left << std::setw(12) << PHASE_NAMES[p] << std::right << std::setprecision(4)
+            << std::setw(10) << phase[p] << std::setprecision(1) << std::setw(8)
+            << 100.0 * phase[p] / seconds << std::setprecision(3) << std::setw(12)
+            << 1e3 * phase[p] / opts.steps << "\n";
+        phases.push_back(bench::JsonObject()
+                             .add("phase", PHASE_NAMES[p])
+                             .add("seconds", phase[p])
+                             .add("fraction", phase[p] / seconds)
+                             .str());
+    }
+    out << std::left << std::setw(12) << "other" << std::right << std::setprecision(4)
+        << std::setw(10) << other << std::setprecision(1) << std::setw(8)
+        << 100.0 * other / seconds << "\n"
+        << std::defaultfloat;
+
+    const std::string data_name = opts.data.empty() ? "synthetic" : opts.data;
+    std::string json = bench::JsonObject()
+                           .add("benchmark", "bench_train")
+                           .add("timestamp", bench::timestamp())
+                           .add("layers", bench::layers_string(opts.layers))
+                           .add("batch", opts.batch)
+                           .add("steps", opts.steps)
+                           .add("val_every", opts.val_every)
+                           .add("val_samples", opts.val_samples)
+                           .add("checkpoint_every", opts.checkpoint_every)
+                           .add("data", data_name)
+                           .add("seconds", seconds)
+                           .add("samples_per_sec", samples_per_sec)
+                           .raw("phases", bench::json_array(phases))
+                           .str() +
+                       "\n";
+    if (!opts.json_path.empty() && !bench::write_file(opts.json_path, json)) {
+        std::cerr << "Failed to write " << opts.json_path << "\n";
+        return 1;
+    }
+
+    if (opts.baseline.empty()) return 0;
+
+    std::ifstream in(opts.baseline);
+    if (!in) {
+        std::cerr << "Cannot read baseline " << opts.baseline << "\n";
+        return 1;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    double base = json_value(text, "samples_per_sec");
+    if (json_text(text, "layers") != bench::layers_string(opts.layers) ||
+        json_value(text, "batch") != opts.batch || json_value(text, "steps") != opts.steps ||
+        json_value(text, "val_every") != opts.val_every ||
+        json_value(text, "val_samples") != opts.val_samples ||
+        json_value(text, "checkpoint_every") != opts.checkpoint_every ||
+        json_text(text, "data") != data_name || !(base > 0)) {
+        std::cerr << "Baseline " << opts.baseline << " is for a different configuration\n";
+        return 1;
+    }
+
+    double change = samples_per_sec / base - 1.0;
+    out << std::fixed << std::setprecision(1) << "Baseline " << base << " samples/s, change "
+        << std::showpos << 100.0 * change << "%" << std::noshowpos << std::defaultfloat
+        << "\n";
+    if (change < -opts.threshold) {
+        std::cerr << "Throughput regressed by more than " << 100.0 * opts.threshold << "%\n";
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#pragma once
+// Shared helpers of the bench_* targets: repeated timing with warm-up, percentiles and a
+// minimal JSON writer for tracking results over time.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// p in [0, 1] of an unsorted sample (nearest rank)
+inline double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t i = (size_t)std::min<double>(v.size() - 1, p * (v.size() - 1) + 0.5);
+    return v[i];
+}
+
+struct Timing {
+    double median = 0.0;  // seconds per call
+    double p95 = 0.0;
+    double min = 0.0;
+    int trials = 0;
+    int calls_per_trial = 0;
+};
+
+// Runs fn `warmup` times, then `trials` timed trials. Fast ops are repeated within a trial
+// until it lasts at least min_trial_seconds, so timer resolution does not dominate.
+template <typename Fn>
+Timing time_it(Fn&& fn, int warmup, int trials, double min_trial_seconds = 1e-3) {
+    for (int i = 0; i < warmup; i++) fn();
+
+    int calls = 1;
+    for (;;) {
+        auto start = Clock::now();
+        for (int i = 0; i < calls; i++) fn();
+        if (seconds_since(start) >= min_trial_seconds || calls >= (1 << 20)) break;
+        calls *= 2;
+    }
+
+    std::vector<double> per_call;
+    for (int t = 0; t < trials; t++) {
+        auto start = Clock::now();
+        for (int i = 0; i < calls; i++) fn();
+        per_call.push_back(seconds_since(start) / calls);
+    }
+
+    Timing r;
+    r.median = percentile(per_call, 0.5);
+    r.p95 = percentile(per_call, 0.95);
+    r.min = *std::min_element(per_call.begin(), per_call.end());
+    r.trials = trials;
+    r.calls_per_trial = calls;
+    return r;
+}
+
+// ---------------------------------------------------------------
+// JSON
+// ---------------------------------------------------------------
+
+inline std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+inline std::string json_number(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.6g", v);
+    return buf;
+}
+
+// one flat JSON object built field by field: {"a":1,"b":"x",...}
+class JsonObject {
+   public:
+    JsonObject& add(const std::string& key, double v) { return raw(key, json_number(v)); }
+    JsonObject& add(const std::string& key, const std::string& v) {
+        return raw(key, json_string(v));
+    }
+    JsonObject& add(const std::string& key, const char* v) { return raw(key, json_string(v)); }
+    JsonObject& raw(const std::string& key, const std::string& json) {
+        m_body += (m_body.empty() ? "" : ",") + json_string(key) + ":" + json;
+        return *this;
+    }
+    std::string str() const { return "{" + m_body + "}"; }
+
+   private:
+    std::string m_body;
+};
+
+// "784,128,10" -> {784, 128, 10}
+inline std::vector<int> parse_list(const std::string& s) {
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) out.push_back(std::atoi(item.c_str()));
+    return out;
+}
+
+// {784, 128, 10} -> "784-128-10"
+inline std::string layers_string(const std::vector<int>& layers) {
+    std::string s;
+    for (size_t i = 0; i < layers.size(); i++) s += (i ? "-" : "") + std::to_string(layers[i]);
+    return s;
+}
+
+inline std::string json_array(const std::vector<std::string>& items) {
+    std::string out = "[";
+    for (size_t i = 0; i < items.size(); i++) out += (i ? ",\n  " : "\n  ") + items[i];
+    return out + (items.empty() ? "]" : "\n]");
+}
+
+inline std::string timestamp() {
+    char buf[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buf;
+}
+
+// writes to `path`, "-" for stdout
+inline bool write_file(const std::string& path, const std::string& text) {
+    if (path == "-") {
+        std::fputs(text.c_str(), stdout);
+        return true;
+    }
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    bool ok = std::fputs(text.c_str(), f) >= 0;
+    return std::fclose(f) == 0 && ok;
+}
+
+}  // namespace bench
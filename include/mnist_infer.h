@@ -0,0 +1,47 @@
+#ifndef MNIST_INFER_H
+#define MNIST_INFER_H
+
+/*
+ * C API of libmnist_infer: inference on single-file models (.mnm, written by convert_model)
+ * without the trainer. Link with -lmnist_infer (shared or static; the static library also
+ * needs -lstdc++ -lpthread).
+ *
+ * Functions report failures by returning NULL / -1; the reason is printed to stderr.
+ */
+
+#include <stdint.h>
+
+#if defined(MNIST_INFER_BUILD) && defined(__GNUC__)
+#define MNIST_INFER_API __attribute__((visibility("default")))
+#else
+#define MNIST_INFER_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mnist_model mnist_model;
+
+/* Maps the model file; NULL if it is missing or invalid. */
+MNIST_INFER_API mnist_model* mnist_model_open(const char* path);
+
+MNIST_INFER_API void mnist_model_close(mnist_model* model);
+
+/* Pixels per sample (784) and number of classes (10). */
+MNIST_INFER_API int mnist_model_input_size(const mnist_model* model);
+MNIST_INFER_API int mnist_model_output_size(const mnist_model* model);
+
+/*
+ * pixels:    n * input_size bytes, sample-major, 0 (background) .. 255 (ink)
+ * probs_out: n * output_size floats of softmax probabilities
+ * Returns 0 on success, -1 on bad arguments. Safe to call from several threads at once.
+ */
+MNIST_INFER_API int mnist_predict_batch(const mnist_model* model, const uint8_t* pixels, int n,
+                                        float* probs_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MNIST_INFER_H */
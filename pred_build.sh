@@ -1,8 +0,0 @@
-
-g++ \
-  src/Predictor/Predictor.cpp \
-  src/NN/neural_network.cpp \
-  src/NN/tensor.cpp \
-  src/utils/Filer.cpp \
-  -Iinclude \
-  -o pred
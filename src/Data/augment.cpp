@@ -0,0 +1,228 @@
+#include "augment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+
+namespace {
+
+constexpr int MAX_SIDE = 64;  // scratch sizing; MNIST images are 28 x 28
+
+uint64_t splitmix64(uint64_t& s) {
+    uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// uniform in [-1, 1)
+float symmetric(uint64_t& s) { return (splitmix64(s) >> 40) * (2.0f / (1 << 24)) - 1.0f; }
+
+// separable blur of a rows x cols field in place, zero padded
+void blur(float* field, int rows, int cols, const std::vector<float>& kernel, float* tmp) {
+    int r = kernel.size() / 2;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            float acc = 0.0f;
+            for (int k = -r; k <= r; k++) {
+                int xx = x + k;
+                if (xx >= 0 && xx < cols) acc += kernel[k + r] * field[y * cols + xx];
+            }
+            tmp[y * cols + x] = acc;
+        }
+    }
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            float acc = 0.0f;
+            for (int k = -r; k <= r; k++) {
+                int yy = y + k;
+                if (yy >= 0 && yy < rows) acc += kernel[k + r] * tmp[yy * cols + x];
+            }
+            field[y * cols + x] = acc;
+        }
+    }
+}
+
+}  // namespace
+
+Augmenter::Augmenter(const AugmentOptions& opts) : m_opts(opts) {
+    if (m_opts.elastic_alpha > 0.0f) {
+        int r = std::max(1, (int)std::ceil(2.0f * m_opts.elastic_sigma));
+        float sum = 0.0f;
+        for (int k = -r; k <= r; k++) {
+            float w = std::exp(-0.5f * k * k / (m_opts.elastic_sigma * m_opts.elastic_sigma));
+            m_kernel.push_back(w);
+            sum += w;
+        }
+        for (float& w : m_kernel) w /= sum;
+    }
+
+    int n = opts.threads > 0 ? opts.threads
+                             : (int)std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < n; i++) m_workers.emplace_back(&Augmenter::run, this);
+}
+
+Augmenter::~Augmenter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) t.join();
+}
+
+void Augmenter::run() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void Augmenter::augment(const uint8_t* src, int rows, int cols, uint64_t key, float* out,
+                        int ld) const {
+    if (rows > MAX_SIDE || cols > MAX_SIDE) throw std::runtime_error("Augmenter: image too large");
+
+    uint64_t s = key;
+    float angle = symmetric(s) * m_opts.max_rotate * (float)M_PI / 180.0f;
+    float scale = 1.0f + symmetric(s) * m_opts.max_scale;
+    float tx = symmetric(s) * m_opts.max_shift;
+    float ty = symmetric(s) * m_opts.max_shift;
+
+    // inverse map: output pixel -> source position, around the image center
+    float c = std::cos(angle) / scale;
+    float sn = std::sin(angle) / scale;
+    float cx = (cols - 1) * 0.5f;
+    float cy = (rows - 1) * 0.5f;
+
+    // source with a one pixel zero border so every bilinear tap is in bounds
+    int pw = cols + 2;
+    float padded[(MAX_SIDE + 2) * (MAX_SIDE + 2)] = {};
+    for (int y = 0; y < rows; y++)
+        for (int x = 0; x < cols; x++) padded[(y + 1) * pw + x + 1] = src[y * cols + x] / 255.0f;
+
+    float dx[MAX_SIDE * MAX_SIDE];
+    float dy[MAX_SIDE * MAX_SIDE];
+    bool elastic = !m_kernel.empty();
+    if (elastic) {
+        float tmp[MAX_SIDE * MAX_SIDE];
+        for (int i = 0; i < rows * cols; i++) {
+            dx[i] = symmetric(s);
+            dy[i] = symmetric(s);
+        }
+        blur(dx, rows, cols, m_kernel, tmp);
+        blur(dy, rows, cols, m_kernel, tmp);
+    }
+
+    float sx[MAX_SIDE];
+    float sy[MAX_SIDE];
+    for (int y = 0; y < rows; y++) {
+        // affine source coordinates of the whole row, then the elastic offsets
+        float oy = y - cy - ty;
+        for (int x = 0; x < cols; x++) {
+            float ox = x - cx - tx;
+            sx[x] = c * ox + sn * oy + cx;
+            sy[x] = -sn * ox + c * oy + cy;
+        }
+        if (elastic) {
+            for (int x = 0; x < cols; x++) {
+                sx[x] += m_opts.elastic_alpha * dx[y * cols + x];
+                sy[x] += m_opts.elastic_alpha * dy[y * cols + x];
+            }
+        }
+
+        // branch-free bilinear taps: clamping into the border keeps indices valid and
+        // samples outside the image read zeros
+        for (int x = 0; x < cols; x++) {
+            float fx = std::clamp(sx[x], -1.0f, cols - 0.001f);
+            float fy = std::clamp(sy[x], -1.0f, rows - 0.001f);
+            int x0 = (int)std::floor(fx);
+            int y0 = (int)std::floor(fy);
+            float wx = fx - x0;
+            float wy = fy - y0;
+
+            const float* p = padded + (y0 + 1) * pw + (x0 + 1);
+            float top = p[0] + wx * (p[1] - p[0]);
+            float bottom = p[pw] + wx * (p[pw + 1] - p[pw]);
+            out[(size_t)(y * cols + x) * ld] = top + wy * (bottom - top);
+        }
+    }
+}
+
+std::future<std::unique_ptr<Tensor>> Augmenter::submit(const Dataset& dataset,
+                                                       const std::vector<int>& order, int start,
+                                                       int batch_size, uint64_t round) {
+    struct Job {
+        std::unique_ptr<Tensor> X;
+        std::promise<std::unique_ptr<Tensor>> done;
+        std::atomic<int> remaining;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;  // the first part that threw
+    };
+
+    auto job = std::make_shared<Job>();
+    job->X = std::make_unique<Tensor>(dataset.pixels(), batch_size);
+    auto result = job->done.get_future();
+
+    int parts = std::min<int>(batch_size, m_workers.size() * 2);
+    job->remaining = parts;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int p = 0; p < parts; p++) {
+            int lo = batch_size * p / parts;
+            int hi = batch_size * (p + 1) / parts;
+            m_tasks.push_back([=, &dataset, &order] {
+                auto t0 = std::chrono::steady_clock::now();
+                float* X = job->X->h_data;
+                try {
+                    for (int b = lo; b < hi; b++) {
+                        int idx = order[start + b];
+                        uint64_t key = m_opts.seed;
+                        key = splitmix64(key) ^ round;
+                        key = splitmix64(key) ^ (uint64_t)idx;
+                        augment(dataset.image(idx), dataset.rows(), dataset.cols(), key, X + b,
+                                batch_size);
+                    }
+                } catch (...) {
+                    if (!job->failed.exchange(true)) job->error = std::current_exception();
+                }
+                m_samples += hi - lo;
+                m_work_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - t0)
+                                 .count();
+                // the future is only made ready once no part touches `dataset` any more, with
+                // the first failure if there was one
+                if (--job->remaining == 0) {
+                    if (job->error)
+                        job->done.set_exception(job->error);
+                    else
+                        job->done.set_value(std::move(job->X));
+                }
+            });
+        }
+    }
+    m_cv.notify_all();
+    return result;
+}
+
+std::unique_ptr<Tensor> Augmenter::collect(std::future<std::unique_ptr<Tensor>>& batch) {
+    auto start = std::chrono::steady_clock::now();
+    auto X = batch.get();
+    m_stall_seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return X;
+}
+
+std::unique_ptr<Tensor> Augmenter::stack(const Dataset& dataset, const std::vector<int>& order,
+                                         int start, int batch_size, uint64_t round) {
+    auto batch = submit(dataset, order, start, batch_size, round);
+    return collect(batch);
+}
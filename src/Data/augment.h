@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Tensor/tensor.h"
+#include "dataset.h"
+
+struct AugmentOptions {
+    float max_shift = 2.0f;       // pixels, each axis
+    float max_rotate = 12.0f;     // degrees
+    float max_scale = 0.1f;       // relative, 0.1 = 90% .. 110%
+    float elastic_alpha = 34.0f;  // elastic displacement strength in pixels, 0 disables
+    float elastic_sigma = 4.0f;   // smoothness of the displacement field
+    int threads = 0;              // 0 = hardware_concurrency
+    uint64_t seed = 0;
+};
+
+// Random per-sample affine (shift / rotate / scale) and elastic distortions, applied while a
+// batch is gathered: stack() is a drop-in for stack_batch_inputs that resamples every image
+// with bilinear interpolation on worker threads.
+//
+// Each sample's transform is drawn from its own generator seeded by (seed, round, index), so
+// results do not depend on the thread count or on which batch a sample lands in.
+// submit() runs asynchronously, letting training prefetch batch i + 1 while it runs batch i.
+class Augmenter {
+   public:
+    explicit Augmenter(const AugmentOptions& opts = {});
+    ~Augmenter();
+
+    Augmenter(const Augmenter&) = delete;
+    Augmenter& operator=(const Augmenter&) = delete;
+
+    // samples order[start .. start + batch_size) as a (pixels x batch_size) tensor in [0, 1];
+    // `dataset` and `order` must stay alive until the future is ready
+    std::future<std::unique_ptr<Tensor>> submit(const Dataset& dataset,
+                                                const std::vector<int>& order, int start,
+                                                int batch_size, uint64_t round);
+    // wait for a submitted batch; the time spent blocked is counted in stall_seconds()
+    std::unique_ptr<Tensor> collect(std::future<std::unique_ptr<Tensor>>& batch);
+    std::unique_ptr<Tensor> stack(const Dataset& dataset, const std::vector<int>& order,
+                                  int start, int batch_size, uint64_t round);
+
+    // one image (rows x cols uint8) into out (rows x cols floats), column stride ld
+    void augment(const uint8_t* src, int rows, int cols, uint64_t key, float* out,
+                 int ld) const;
+
+    int threads() const { return m_workers.size(); }
+    long samples() const { return m_samples; }
+    double work_seconds() const { return m_work_ns * 1e-9; }  // summed over the workers
+    double stall_seconds() const { return m_stall_seconds; }
+
+   private:
+    void run();
+
+    AugmentOptions m_opts;
+    std::vector<float> m_kernel;  // 1D Gaussian for smoothing the elastic field
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+
+    std::atomic<long> m_samples{0};
+    std::atomic<long> m_work_ns{0};
+    double m_stall_seconds = 0.0;
+};
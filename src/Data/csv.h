@@ -0,0 +1,50 @@
+#pragma once
+#include <charconv>
+#include <cstring>
+
+// Allocation-free helpers for the numeric CSV files used here (datasets and tensors),
+// shared by the whole-file parser in Filer and the streaming reader.
+
+// one line of text, without its line break
+struct CsvLine {
+    const char* begin;
+    const char* end;
+};
+
+// splits off the line starting at p and returns the start of the next one (or end)
+inline const char* csv_next_line(const char* p, const char* end, CsvLine& line) {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    const char* stop = nl ? nl : end;
+    line.begin = p;
+    line.end = (stop > p && stop[-1] == '\r') ? stop - 1 : stop;
+    return nl ? nl + 1 : end;
+}
+
+// parse one comma separated number, skipping surrounding blanks; false on garbage
+template <typename T>
+bool csv_field(const char*& p, const char* end, T& value) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == '+') p++;
+    auto [next, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) return false;
+    p = next;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end) {
+        if (*p != ',') return false;
+        p++;
+    }
+    return true;
+}
+
+// number of fields on the line (all of them, so bad rows can be reported), the first
+// `max` are written to out (divided by `div`); -1 if a field is not a number
+inline int csv_floats(const char* p, const char* end, float* out, int max, float div) {
+    int n = 0;
+    while (p < end) {
+        float v;
+        if (!csv_field(p, end, v)) return -1;
+        if (n < max) out[n] = v / div;
+        n++;
+    }
+    return n;
+}
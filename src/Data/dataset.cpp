@@ -0,0 +1,160 @@
+#include "dataset.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+#include "../Trace/trace.h"
+#include "csv.h"
+#include "dataset_cache.h"
+#include "mapped_file.h"
+#include "parallel_for.h"
+
+void Dataset::add(const uint8_t* pixels, int label) {
+    m_pixels.insert(m_pixels.end(), pixels, pixels + this->pixels());
+    m_labels.push_back(label);
+}
+
+std::unique_ptr<Tensor> Dataset::tensor(int i) const {
+    auto t = std::make_unique<Tensor>(m_rows, m_cols);
+    const uint8_t* px = image(i);
+    for (int k = 0; k < pixels(); k++) t->h_data[k] = px[k] / 255.0f;
+    return t;
+}
+
+std::unique_ptr<Dataset> Dataset::from_imgs(const std::vector<Filer::Img>& imgs) {
+    if (imgs.empty()) return std::make_unique<Dataset>(28, 28);
+
+    auto ds = std::make_unique<Dataset>(imgs[0].img_data->rows, imgs[0].img_data->cols);
+    ds->m_pixels.reserve(imgs.size() * ds->pixels());
+    ds->m_labels.reserve(imgs.size());
+
+    std::vector<uint8_t> px(ds->pixels());
+    for (const auto& img : imgs) {
+        for (int k = 0; k < ds->pixels(); k++) {
+            float v = std::round(img.img_data->h_data[k] * 255.0f);
+            px[k] = (uint8_t)std::clamp(v, 0.0f, 255.0f);
+        }
+        ds->add(px.data(), img.label);
+    }
+    return ds;
+}
+
+template <typename Source>
+static std::unique_ptr<Dataset> select_rows(const Source& src, int nums, int shard,
+                                            int num_shards) {
+    auto ds = std::make_unique<Dataset>(src.rows(), src.cols());
+    int n = std::min(nums, src.size());
+
+    for (int i = 0; i < n; i++) {
+        if (num_shards > 1 && i % num_shards != shard) continue;
+        ds->add(src.image(i), src.label(i));
+    }
+    return ds;
+}
+
+// Every row of the CSV parsed straight into 8-bit pixels, without float images in between.
+// `exact` turns false if a pixel was not a whole number in [0, 255] and had to be rounded.
+std::unique_ptr<Dataset> Dataset::parse_csv(const std::string& csv_path, bool& exact) {
+    TRACE_SCOPE("Dataset::parse_csv");
+    MappedFile file;
+    if (!file.open(csv_path)) return nullptr;
+    file.advise_sequential();
+
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
+
+    CsvLine header;
+    p = csv_next_line(p, end, header);
+    std::string_view header_text(header.begin, header.end - header.begin);
+    bool has_label = header_text.find("label") != std::string::npos;
+
+    std::vector<CsvLine> lines;
+    while (p < end) {
+        CsvLine line;
+        p = csv_next_line(p, end, line);
+        if (line.begin != line.end) lines.push_back(line);  // blank lines
+    }
+
+    constexpr int PIXELS = 28 * 28;
+    auto ds = std::make_unique<Dataset>(28, 28);
+    ds->m_pixels.resize(lines.size() * PIXELS);
+    ds->m_labels.resize(lines.size(), -1);
+
+    std::vector<int> fields(lines.size());
+    std::atomic<bool> rounded{false};
+    parallel_for(lines.size(), 256, [&](size_t i) {
+        const char* q = lines[i].begin;
+        int label = -1;
+        if (has_label && !csv_field(q, lines[i].end, label)) {
+            fields[i] = -1;
+            return;
+        }
+        float values[PIXELS];
+        fields[i] = csv_floats(q, lines[i].end, values, PIXELS, 1.0f);
+        if (fields[i] != PIXELS) return;
+
+        uint8_t* px = ds->m_pixels.data() + i * PIXELS;
+        for (int k = 0; k < PIXELS; k++) {
+            float v = std::clamp(std::round(values[k]), 0.0f, 255.0f);
+            if (v != values[k]) rounded.store(true, std::memory_order_relaxed);
+            px[k] = (uint8_t)v;
+        }
+        ds->m_labels[i] = label;
+    });
+
+    // drop rows with a bad pixel count, keeping the order of the rest
+    size_t kept = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (fields[i] != PIXELS) {
+            std::cerr << "Warning: invalid pixel count at row " << i
+                      << " count = " << std::max(0, fields[i]) << std::endl;
+            continue;
+        }
+        if (kept != i) {
+            std::memcpy(ds->m_pixels.data() + kept * PIXELS, ds->m_pixels.data() + i * PIXELS,
+                        PIXELS);
+            ds->m_labels[kept] = ds->m_labels[i];
+        }
+        kept++;
+    }
+    ds->m_pixels.resize(kept * PIXELS);
+    ds->m_labels.resize(kept);
+
+    exact = !rounded;
+    std::cout << "Parsed " << kept << " MNIST rows from " << csv_path << std::endl;
+    return ds;
+}
+
+std::unique_ptr<Dataset> Dataset::from_csv(const std::string& csv_path, int nums, int shard,
+                                           int num_shards) {
+    std::unique_ptr<Dataset> ds;
+
+    if (auto cache = DatasetCache::open(csv_path)) {
+        ds = select_rows(*cache, nums, shard, num_shards);
+        std::cout << "Loaded " << ds->size() << " MNIST rows from "
+                  << DatasetCache::path_for(csv_path) << " (" << ds->bytes() / 1024 << " KB)"
+                  << std::endl;
+        return ds;
+    }
+
+    bool exact = true;
+    auto all = parse_csv(csv_path, exact);
+    if (!all || all->empty()) return nullptr;
+
+    if (!exact)
+        std::cerr << "Warning: " << csv_path << " has pixels that are not whole numbers in "
+                  << "[0, 255]; they are rounded to 8 bits in memory and not cached" << std::endl;
+    else if (!DatasetCache::write(csv_path, *all))
+        std::cerr << "Warning: could not write dataset cache for " << csv_path << std::endl;
+
+    if (num_shards <= 1 && nums >= all->size()) return all;
+    return select_rows(*all, nums, shard, num_shards);
+}
+
+std::unique_ptr<Dataset> Dataset::from_idx(const IdxDataset& idx, int nums, int shard,
+                                           int num_shards) {
+    return select_rows(idx, nums, shard, num_shards);
+}
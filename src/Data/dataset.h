@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Filer.h"
+#include "idx_dataset.h"
+
+// One split of MNIST held as a single contiguous uint8 pixel buffer plus a label array
+// (about a quarter of the memory of per-image float Tensors). Training shuffles a
+// permutation of indices (TrainState::order) and pixels are normalized while a batch is
+// gathered, so the images themselves never move.
+class Dataset {
+   public:
+    Dataset(int rows, int cols) : m_rows(rows), m_cols(cols) {}
+
+    // Rows [0, nums) of the CSV that belong to `shard`, read through the binary cache
+    // (Data/dataset_cache.h), which is rebuilt first when missing or stale.
+    static std::unique_ptr<Dataset> from_csv(const std::string& csv_path, int nums,
+                                             int shard = 0, int num_shards = 1);
+    static std::unique_ptr<Dataset> from_idx(const IdxDataset& idx, int nums, int shard = 0,
+                                             int num_shards = 1);
+    // pixels are rounded to the nearest k / 255
+    static std::unique_ptr<Dataset> from_imgs(const std::vector<Filer::Img>& imgs);
+
+    void add(const uint8_t* pixels, int label);
+    void clear() {
+        m_pixels.clear();
+        m_labels.clear();
+    }
+
+    int size() const { return m_labels.size(); }
+    bool empty() const { return m_labels.empty(); }
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    int pixels() const { return m_rows * m_cols; }
+    size_t bytes() const { return m_pixels.size() + m_labels.size(); }
+
+    const uint8_t* image(int i) const { return m_pixels.data() + (size_t)i * pixels(); }
+    int label(int i) const { return m_labels[i]; }
+
+    // normalized rows x cols copy of image i
+    std::unique_ptr<Tensor> tensor(int i) const;
+
+   private:
+    static std::unique_ptr<Dataset> parse_csv(const std::string& csv_path, bool& exact);
+
+    int m_rows;
+    int m_cols;
+    std::vector<uint8_t> m_pixels;
+    std::vector<int8_t> m_labels;  // -1 when the source had no labels
+};
@@ -0,0 +1,118 @@
+#include "dataset_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "dataset.h"
+
+namespace {
+
+constexpr char MAGIC[4] = {'M', 'N', 'D', 'C'};
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t count;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t has_label;
+};
+
+uint64_t fnv1a(const void* data, size_t n, uint64_t h = 1469598103934665603ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+}  // namespace
+
+std::string DatasetCache::path_for(const std::string& csv_path) { return csv_path + ".cache"; }
+
+uint64_t DatasetCache::source_hash(const std::string& csv_path) {
+    struct stat st;
+    if (stat(csv_path.c_str(), &st) != 0) return 0;
+
+    int64_t fields[3] = {(int64_t)st.st_size, (int64_t)st.st_mtim.tv_sec,
+                         (int64_t)st.st_mtim.tv_nsec};
+    return fnv1a(fields, sizeof(fields));
+}
+
+std::unique_ptr<DatasetCache> DatasetCache::open(const std::string& csv_path) {
+    std::string path = path_for(csv_path);
+    if (access(path.c_str(), R_OK) != 0) return nullptr;
+
+    std::unique_ptr<DatasetCache> cache(new DatasetCache());
+    if (!cache->m_file.open(path)) return nullptr;
+
+    const MappedFile& file = cache->m_file;
+    Header h;
+    if (file.size() < sizeof(h)) return nullptr;
+    std::memcpy(&h, file.data(), sizeof(h));
+
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION) {
+        std::cerr << "Ignoring unrecognized dataset cache " << path << "\n";
+        return nullptr;
+    }
+    if (h.source_hash != source_hash(csv_path)) {
+        std::cout << "Dataset cache " << path << " is stale, rebuilding\n";
+        return nullptr;
+    }
+
+    uint64_t pixels = (uint64_t)h.count * h.rows * h.cols;
+    if (file.size() != sizeof(h) + h.count + pixels) {
+        std::cerr << "Ignoring truncated dataset cache " << path << "\n";
+        return nullptr;
+    }
+
+    cache->m_labels = file.data() + sizeof(h);
+    cache->m_pixels = cache->m_labels + h.count;
+    cache->m_count = h.count;
+    cache->m_rows = h.rows;
+    cache->m_cols = h.cols;
+    cache->m_has_label = h.has_label != 0;
+    return cache;
+}
+
+bool DatasetCache::write(const std::string& csv_path, const Dataset& data) {
+    if (data.empty()) return false;
+
+    Header h;
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.source_hash = source_hash(csv_path);
+    h.count = data.size();
+    h.rows = data.rows();
+    h.cols = data.cols();
+    h.has_label = data.label(0) >= 0;
+
+    std::vector<uint8_t> labels(h.count);
+    for (uint32_t i = 0; i < h.count; i++) labels[i] = h.has_label ? data.label(i) : 0;
+    const uint8_t* pixels = data.image(0);  // one contiguous buffer
+    size_t pixel_bytes = (size_t)h.count * data.pixels();
+
+    std::string path = path_for(csv_path);
+    std::string tmp = path + ".tmp-" + std::to_string(getpid());
+
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+              std::fwrite(labels.data(), 1, labels.size(), f) == labels.size() &&
+              std::fwrite(pixels, 1, pixel_bytes, f) == pixel_bytes;
+    ok = std::fclose(f) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+class Dataset;
+
+// Parsed copy of an MNIST CSV kept next to it as <csv>.cache, so later runs mmap it instead
+// of parsing text again. Only valid while the CSV keeps the size and mtime it was built from.
+//
+// Layout (native endian):
+//   "MNDC" | u32 version | u64 source hash | u32 count | u32 rows | u32 cols | u32 has_label
+//   | u8 labels[count] | u8 pixels[count * rows * cols]
+class DatasetCache {
+   public:
+    static std::string path_for(const std::string& csv_path);
+
+    // FNV-1a of the file size and mtime; 0 if the file cannot be stat'ed
+    static uint64_t source_hash(const std::string& csv_path);
+
+    // nullptr when there is no cache yet or it is stale / corrupt (a rebuild is due)
+    static std::unique_ptr<DatasetCache> open(const std::string& csv_path);
+
+    // Every row of the CSV, already in 8-bit form. Written to a temporary file and renamed
+    // into place.
+    static bool write(const std::string& csv_path, const Dataset& data);
+
+    int size() const { return m_count; }
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    int pixels() const { return m_rows * m_cols; }
+    bool has_label() const { return m_has_label; }
+
+    const uint8_t* image(int i) const { return m_pixels + (size_t)i * pixels(); }
+    int label(int i) const { return m_has_label ? m_labels[i] : -1; }
+
+   private:
+    DatasetCache() = default;
+
+    MappedFile m_file;
+    const uint8_t* m_labels = nullptr;
+    const uint8_t* m_pixels = nullptr;
+    int m_count = 0;
+    int m_rows = 0;
+    int m_cols = 0;
+    bool m_has_label = false;
+};
@@ -0,0 +1,70 @@
+#include "idx_dataset.h"
+
+#include <iostream>
+
+namespace {
+
+constexpr uint32_t IMAGES_MAGIC = 0x00000803;  // unsigned byte, 3 dimensions
+constexpr uint32_t LABELS_MAGIC = 0x00000801;  // unsigned byte, 1 dimension
+
+uint32_t read_be32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+}  // namespace
+
+std::unique_ptr<IdxDataset> IdxDataset::open(const std::string& images_path,
+                                             const std::string& labels_path) {
+    std::unique_ptr<IdxDataset> ds(new IdxDataset());
+    if (!ds->m_image_file.open(images_path) || !ds->m_label_file.open(labels_path))
+        return nullptr;
+
+    const MappedFile& images = ds->m_image_file;
+    const MappedFile& labels = ds->m_label_file;
+
+    if (images.size() < 16 || read_be32(images.data()) != IMAGES_MAGIC) {
+        std::cerr << "Not an IDX image file: " << images_path << "\n";
+        return nullptr;
+    }
+    if (labels.size() < 8 || read_be32(labels.data()) != LABELS_MAGIC) {
+        std::cerr << "Not an IDX label file: " << labels_path << "\n";
+        return nullptr;
+    }
+
+    uint32_t count = read_be32(images.data() + 4);
+    uint32_t rows = read_be32(images.data() + 8);
+    uint32_t cols = read_be32(images.data() + 12);
+    uint32_t label_count = read_be32(labels.data() + 4);
+
+    if (rows == 0 || cols == 0 || rows > 4096 || cols > 4096 || count > INT32_MAX) {
+        std::cerr << "Invalid IDX image dimensions in " << images_path << "\n";
+        return nullptr;
+    }
+    if (images.size() != 16 + (uint64_t)count * rows * cols) {
+        std::cerr << "IDX image file size does not match its header: " << images_path << "\n";
+        return nullptr;
+    }
+    if (label_count != count || labels.size() != 8 + (uint64_t)count) {
+        std::cerr << "IDX label file does not match the images: " << labels_path << "\n";
+        return nullptr;
+    }
+
+    const uint8_t* label_data = labels.data() + 8;
+    for (uint32_t i = 0; i < count; i++) {
+        if (label_data[i] > 9) {
+            std::cerr << "Invalid label " << (int)label_data[i] << " at " << i << " in "
+                      << labels_path << "\n";
+            return nullptr;
+        }
+    }
+
+    ds->m_pixels = images.data() + 16;
+    ds->m_labels = label_data;
+    ds->m_count = count;
+    ds->m_rows = rows;
+    ds->m_cols = cols;
+
+    std::cout << "Mapped " << count << " IDX images (" << rows << "x" << cols << ") from "
+              << images_path << std::endl;
+    return ds;
+}
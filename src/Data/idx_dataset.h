@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "mapped_file.h"
+
+// MNIST in the original IDX format (train-images-idx3-ubyte / train-labels-idx1-ubyte).
+// Both files are mmap'ed, so opening even the 60k set costs two syscalls; Dataset::from_idx
+// copies the rows a run trains on, still as uint8.
+//
+// Header layout (big-endian u32): magic 0x00000803 | count | rows | cols for images,
+// magic 0x00000801 | count for labels.
+class IdxDataset {
+   public:
+    // nullptr (with the reason on stderr) if a file is missing, malformed or the two disagree
+    static std::unique_ptr<IdxDataset> open(const std::string& images_path,
+                                            const std::string& labels_path);
+
+    int size() const { return m_count; }
+    int rows() const { return m_rows; }
+    int cols() const { return m_cols; }
+    int pixels() const { return m_rows * m_cols; }
+
+    const uint8_t* image(int i) const { return m_pixels + (size_t)i * pixels(); }
+    int label(int i) const { return m_labels[i]; }
+
+   private:
+    IdxDataset() = default;
+
+    MappedFile m_image_file;
+    MappedFile m_label_file;
+
+    const uint8_t* m_pixels = nullptr;
+    const uint8_t* m_labels = nullptr;
+    int m_count = 0;
+    int m_rows = 0;
+    int m_cols = 0;
+};
@@ -0,0 +1,65 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+MappedFile::~MappedFile() { close(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : m_data(other.m_data), m_size(other.m_size) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "Cannot map empty or unreadable file " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file referenced
+    if (p == MAP_FAILED) {
+        std::cerr << "mmap failed for " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    m_data = static_cast<uint8_t*>(p);
+    m_size = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) munmap(m_data, m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedFile::advise_sequential() const {
+    if (m_data) madvise(m_data, m_size, MADV_SEQUENTIAL);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only mmap of a whole file. Pages are loaded lazily by the kernel and shared with
+// every other process mapping the same file.
+class MappedFile {
+   public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // prints the reason and returns false on failure
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool is_open() const { return m_data != nullptr; }
+
+    // hint that the file will be read front to back (MADV_SEQUENTIAL)
+    void advise_sequential() const;
+
+   private:
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
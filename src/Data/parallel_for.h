@@ -0,0 +1,29 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// run fn(i) for i in [0, n) on up to hardware_concurrency threads, in contiguous chunks of
+// at least min_chunk (smaller inputs stay on the calling thread)
+template <typename Fn>
+void parallel_for(size_t n, size_t min_chunk, Fn fn) {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, (n + min_chunk - 1) / min_chunk);
+
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; i++) fn(i);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    size_t chunk = (n + threads - 1) / threads;
+    for (size_t t = 0; t < threads; t++) {
+        size_t lo = t * chunk;
+        size_t hi = std::min(n, lo + chunk);
+        pool.emplace_back([=, &fn] {
+            for (size_t i = lo; i < hi; i++) fn(i);
+        });
+    }
+    for (auto& th : pool) th.join();
+}
@@ -0,0 +1,216 @@
+#include "stream_dataset.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+#include "csv.h"
+
+namespace fs = std::filesystem;
+
+constexpr int ROWS = 28;
+constexpr int COLS = 28;
+constexpr int PIXELS = ROWS * COLS;
+
+StreamDataset::StreamDataset(const std::vector<std::string>& files, const StreamOptions& opts)
+    : m_files(files), m_opts(opts) {
+    size_t sample_bytes = PIXELS + 1;
+    size_t reserved = 2 * m_opts.chunk_bytes;
+    size_t fit = m_opts.memory_budget > reserved ? (m_opts.memory_budget - reserved) / sample_bytes
+                                                 : 1;
+    m_capacity = (int)std::max<size_t>(1, std::min<size_t>(m_opts.shuffle_buffer, fit));
+    if (m_capacity < m_opts.shuffle_buffer) {
+        std::cerr << "Warning: shuffle buffer capped at " << m_capacity
+                  << " samples by the memory budget" << std::endl;
+    }
+
+    size_t data_bytes = 0;
+    size_t sampled_rows = 0;
+    size_t sampled_bytes = 0;
+
+    for (int f = 0; f < (int)files.size(); f++) {
+        std::error_code ec;
+        size_t size = fs::file_size(files[f], ec);
+        std::ifstream in(files[f], std::ios::binary);
+        if (ec || !in) throw std::runtime_error("Cannot open stream source " + files[f]);
+
+        // the header line decides whether rows start with a label, as in Filer::get_data
+        std::string header;
+        std::getline(in, header);
+        m_has_label.push_back(header.find("label") != std::string::npos);
+        size_t data_start = std::min(size, header.size() + 1);
+
+        // average row length from the first 64 KB, for estimated_samples()
+        std::vector<char> probe(64 << 10);
+        in.read(probe.data(), probe.size());
+        size_t got = in.gcount();
+        sampled_rows += std::count(probe.begin(), probe.begin() + got, '\n');
+        sampled_bytes += got;
+
+        for (size_t b = data_start; b < size; b += m_opts.shard_bytes)
+            m_shards.push_back({f, b, std::min(size, b + m_opts.shard_bytes)});
+        data_bytes += size - data_start;
+    }
+
+    if (sampled_rows > 0) m_estimated_samples = data_bytes / (sampled_bytes / sampled_rows);
+
+    m_pixels.resize((size_t)m_capacity * PIXELS);
+    m_labels.resize(m_capacity);
+    m_text.reserve(m_opts.chunk_bytes * 2);
+}
+
+void StreamDataset::start_epoch(uint32_t seed) {
+    m_rng.seed(seed);
+    std::shuffle(m_shards.begin(), m_shards.end(), m_rng);
+
+    m_next_shard = 0;
+    m_in.close();
+    m_eof = true;
+    m_text.clear();
+    m_text_pos = 0;
+    m_shard_end = 0;
+    m_pos = 0;
+
+    m_filled = 0;
+    m_primed = false;
+    m_samples = 0;
+    m_bytes_read = 0;
+    m_read_seconds = 0.0;
+}
+
+bool StreamDataset::open_next_shard() {
+    if (m_next_shard >= m_shards.size()) return false;
+    const Shard& shard = m_shards[m_next_shard++];
+
+    m_in.close();
+    m_in.clear();
+    m_in.open(m_files[shard.file], std::ios::binary);
+    if (!m_in) {
+        std::cerr << "Failed to open " << m_files[shard.file] << std::endl;
+        return false;
+    }
+
+    // start one byte early: rows are owned by the shard they start in, so everything up to
+    // and including the first line break belongs to the previous shard
+    m_in.seekg(shard.begin - 1);
+    m_pos = shard.begin - 1;
+    m_shard_end = shard.end;
+    m_shard_label = m_has_label[shard.file];
+    m_text.clear();
+    m_text_pos = 0;
+    m_eof = false;
+
+    for (;;) {
+        const char* begin = m_text.data() + m_text_pos;
+        const char* nl = static_cast<const char*>(
+            std::memchr(begin, '\n', m_text.size() - m_text_pos));
+        if (nl) {
+            m_pos += nl + 1 - begin;
+            m_text_pos += nl + 1 - begin;
+            return true;
+        }
+        m_pos += m_text.size() - m_text_pos;
+        m_text_pos = m_text.size();
+        if (!refill_text()) return true;  // shard ends inside its first line: nothing to read
+    }
+}
+
+bool StreamDataset::refill_text() {
+    if (m_eof) return false;
+
+    m_text.erase(m_text.begin(), m_text.begin() + m_text_pos);
+    m_text_pos = 0;
+
+    size_t old = m_text.size();
+    m_text.resize(old + m_opts.chunk_bytes);
+    m_in.read(m_text.data() + old, m_opts.chunk_bytes);
+    size_t got = m_in.gcount();
+    m_text.resize(old + got);
+    m_bytes_read += got;
+
+    if (got == 0) m_eof = true;
+    return got > 0;
+}
+
+bool StreamDataset::read_sample(uint8_t* pixels, int8_t& label) {
+    float values[PIXELS];
+
+    for (;;) {
+        if (m_pos >= m_shard_end) return false;
+
+        const char* begin = m_text.data() + m_text_pos;
+        size_t avail = m_text.size() - m_text_pos;
+        const char* nl = static_cast<const char*>(std::memchr(begin, '\n', avail));
+
+        if (!nl && refill_text()) continue;
+        if (!nl && avail == 0) return false;  // end of file
+
+        CsvLine line;
+        const char* next = csv_next_line(begin, begin + avail, line);
+        m_pos += next - begin;
+        m_text_pos += next - begin;
+        if (line.begin == line.end) continue;
+
+        const char* p = line.begin;
+        int lbl = -1;
+        bool ok = !m_shard_label || csv_field(p, line.end, lbl);
+
+        int n = ok ? csv_floats(p, line.end, values, PIXELS, 1.0f) : -1;
+        if (n != PIXELS) {
+            std::cerr << "Warning: invalid pixel count at offset " << m_pos
+                      << " count = " << std::max(0, n) << std::endl;
+            continue;
+        }
+
+        for (int i = 0; i < PIXELS; i++)
+            pixels[i] = (uint8_t)std::clamp(std::round(values[i]), 0.0f, 255.0f);
+        label = lbl;
+        return true;
+    }
+}
+
+bool StreamDataset::next_batch(int n, Dataset& batch) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto pull = [&](int slot) {
+        uint8_t* px = m_pixels.data() + (size_t)slot * PIXELS;
+        while (!read_sample(px, m_labels[slot]))
+            if (!open_next_shard()) return false;
+        return true;
+    };
+
+    if (!m_primed) {
+        while (m_filled < m_capacity && pull(m_filled)) m_filled++;
+        m_primed = true;
+    }
+
+    batch.clear();
+    for (int i = 0; i < n && m_filled > 0; i++) {
+        int j = std::uniform_int_distribution<int>(0, m_filled - 1)(m_rng);
+        batch.add(m_pixels.data() + (size_t)j * PIXELS, m_labels[j]);
+
+        if (!pull(j)) {
+            // stream drained: close the gap with the last buffered sample
+            int last = --m_filled;
+            std::memcpy(m_pixels.data() + (size_t)j * PIXELS,
+                        m_pixels.data() + (size_t)last * PIXELS, PIXELS);
+            m_labels[j] = m_labels[last];
+        }
+    }
+
+    m_samples += batch.size();
+    m_read_seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return !batch.empty();
+}
+
+size_t resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
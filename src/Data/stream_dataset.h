@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+
+struct StreamOptions {
+    size_t memory_budget = 64 << 20;  // decoded samples + read buffer held at once, in bytes
+    int shuffle_buffer = 16384;       // samples; capped by what fits in memory_budget
+    size_t chunk_bytes = 1 << 20;     // text read per syscall
+    size_t shard_bytes = 16 << 20;    // files are split into byte ranges of about this size
+};
+
+// Training data read from one or more CSV files while training, never held in full.
+//
+// Every file is split into byte-range shards (cut at line boundaries when read). An epoch
+// visits all shards in a random order and passes the rows through a shuffle buffer: the
+// buffer is filled first, then each emitted sample is drawn at random from it and its slot
+// refilled from the stream. Memory stays at shuffle buffer + one read chunk regardless of
+// corpus size; the shuffle is only approximate for corpora much larger than the buffer.
+class StreamDataset {
+   public:
+    StreamDataset(const std::vector<std::string>& files, const StreamOptions& opts = {});
+
+    // reshuffle the shard order and rewind; `seed` makes the epoch reproducible
+    void start_epoch(uint32_t seed);
+
+    // Replace `batch` with up to n samples; returns false once the epoch is exhausted.
+    bool next_batch(int n, Dataset& batch);
+
+    int capacity() const { return m_capacity; }
+    long estimated_samples() const { return m_estimated_samples; }
+
+    // totals for the current epoch
+    long samples() const { return m_samples; }
+    size_t bytes_read() const { return m_bytes_read; }
+    double read_seconds() const { return m_read_seconds; }  // reading + parsing only
+
+   private:
+    struct Shard {
+        int file;
+        size_t begin;  // byte range [begin, end) owning the lines that start inside it
+        size_t end;
+    };
+
+    bool open_next_shard();
+    bool read_sample(uint8_t* pixels, int8_t& label);  // next row from the shard stream
+    bool refill_text();
+
+    std::vector<std::string> m_files;
+    std::vector<bool> m_has_label;
+    std::vector<Shard> m_shards;
+    StreamOptions m_opts;
+    int m_capacity = 0;
+    long m_estimated_samples = 0;
+
+    std::mt19937 m_rng;
+    size_t m_next_shard = 0;
+
+    // current shard
+    std::ifstream m_in;
+    size_t m_pos = 0;  // file offset of m_text[m_text_pos]
+    size_t m_shard_end = 0;
+    bool m_shard_label = false;
+    std::vector<char> m_text;
+    size_t m_text_pos = 0;
+    bool m_eof = true;
+
+    // shuffle buffer
+    std::vector<uint8_t> m_pixels;
+    std::vector<int8_t> m_labels;
+    int m_filled = 0;
+    bool m_primed = false;
+
+    long m_samples = 0;
+    size_t m_bytes_read = 0;
+    double m_read_seconds = 0.0;
+};
+
+// resident set size of this process, from /proc/self/statm (0 if unavailable)
+size_t resident_bytes();
@@ -0,0 +1,137 @@
+#include "data_parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#include "../NN/pruning.h"
+
+DataParallel::DataParallel(Transport& transport, const NeuralNetwork* net)
+    : m_transport(transport) {
+    size_t params = 0;
+    for (size_t i = 0; i < net->weights.size(); i++)
+        params += net->weights[i]->size() + net->biases[i]->size();
+
+    m_flat.resize(params);
+    m_scratch.resize((params + world() - 1) / world() + 1);
+}
+
+void DataParallel::allreduce_sum(float* data, size_t count) {
+    int W = world();
+    int r = rank();
+    if (W == 1 || count == 0) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t chunk = (count + W - 1) / W;
+    auto begin = [&](int c) { return std::min(count, (size_t)c * chunk); };
+    auto length = [&](int c) { return begin(c + 1) - begin(c); };
+    if (m_scratch.size() < chunk) m_scratch.resize(chunk);
+
+    // reduce-scatter: afterwards rank r owns the full sum of chunk (r + 1) % W
+    for (int s = 0; s < W - 1; s++) {
+        int send_c = (r - s + W) % W;
+        int recv_c = (r - s - 1 + 2 * W) % W;
+
+        m_transport.exchange(data + begin(send_c), length(send_c) * sizeof(float),
+                             m_scratch.data(), length(recv_c) * sizeof(float));
+        bytes_sent += length(send_c) * sizeof(float);
+
+        float* dst = data + begin(recv_c);
+        for (size_t i = 0; i < length(recv_c); i++) dst[i] += m_scratch[i];
+    }
+
+    // allgather: pass the finished chunks around the ring
+    for (int s = 0; s < W - 1; s++) {
+        int send_c = (r + 1 - s + W) % W;
+        int recv_c = (r - s + W) % W;
+
+        m_transport.exchange(data + begin(send_c), length(send_c) * sizeof(float),
+                             data + begin(recv_c), length(recv_c) * sizeof(float));
+        bytes_sent += length(send_c) * sizeof(float);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    comm_seconds += std::chrono::duration<double>(end - start).count();
+}
+
+void DataParallel::broadcast_params(NeuralNetwork* net) {
+    size_t off = 0;
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        for (Tensor* t : {net->weights[i].get(), net->biases[i].get()}) {
+            if (rank() == 0) {
+                std::memcpy(m_flat.data() + off, t->h_data, t->size() * sizeof(float));
+            } else {
+                std::fill(m_flat.begin() + off, m_flat.begin() + off + t->size(), 0.0f);
+            }
+            off += t->size();
+        }
+    }
+
+    allreduce_sum(m_flat.data(), m_flat.size());
+
+    off = 0;
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        for (Tensor* t : {net->weights[i].get(), net->biases[i].get()}) {
+            std::memcpy(t->h_data, m_flat.data() + off, t->size() * sizeof(float));
+            off += t->size();
+        }
+    }
+}
+
+void DataParallel::average_gradients(BackwardCache& grads) {
+    size_t off = 0;
+    for (size_t i = 0; i < grads.dW.size(); i++) {
+        for (Tensor* t : {grads.dW[i].get(), grads.dB[i].get()}) {
+            std::memcpy(m_flat.data() + off, t->h_data, t->size() * sizeof(float));
+            off += t->size();
+        }
+    }
+
+    allreduce_sum(m_flat.data(), off);
+
+    float scale = 1.0f / world();
+    off = 0;
+    for (size_t i = 0; i < grads.dW.size(); i++) {
+        for (Tensor* t : {grads.dW[i].get(), grads.dB[i].get()}) {
+            for (int k = 0; k < t->size(); k++) t->h_data[k] = m_flat[off + k] * scale;
+            off += t->size();
+        }
+    }
+}
+
+std::vector<float> DataParallel::gather(float value) {
+    std::vector<float> values(world(), 0.0f);
+    values[rank()] = value;
+    allreduce_sum(values.data(), values.size());
+    return values;
+}
+
+int DataParallel::agree_min(int value) {
+    auto values = gather((float)value);
+    return (int)*std::min_element(values.begin(), values.end());
+}
+
+void Train_batch_imgs(NeuralNetwork* net, const Dataset& shard, int batch_size, TrainState& state,
+                      DataParallel& dp, Pruner* pruner) {
+    if ((int)state.order.size() != (int)shard.size()) state.reset_order(shard.size());
+    std::shuffle(state.order.begin(), state.order.end(), state.rng);
+
+    int total = dp.agree_min(shard.size());
+
+    for (int start = 0; start < total; start += batch_size) {
+        int bs = std::min(batch_size, total - start);
+
+        auto X = stack_batch_inputs(shard, state.order, start, bs);
+        auto Y = stack_batch_labels(shard, state.order, start, bs);
+
+        auto cache = forward_pass_batch(net, X.get());
+        auto grads = backward_pass_batch(net, cache, Y.get());
+        dp.average_gradients(grads);
+        update_params(net, grads);
+        state.step++;
+
+        if (pruner) pruner->step(net);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <functional>
+#include <vector>
+
+#include "../NN/neural_network.h"
+#include "transport.h"
+
+// Synchronous data-parallel SGD on top of a ring Transport.
+// Every rank trains on its own shard; after each backward pass the gradients are summed
+// with a ring allreduce (reduce-scatter then allgather, 2 * (world - 1) neighbour exchanges
+// of 1/world of the data each) and divided by world, so all replicas apply the same update.
+class DataParallel {
+   public:
+    DataParallel(Transport& transport, const NeuralNetwork* net);
+
+    int rank() const { return m_transport.rank(); }
+    int world() const { return m_transport.world(); }
+
+    void broadcast_params(NeuralNetwork* net);  // copy rank 0's parameters to every rank
+    void average_gradients(BackwardCache& grads);
+
+    // rank-indexed values, available on every rank
+    std::vector<float> gather(float value);
+    int agree_min(int value);
+
+    void allreduce_sum(float* data, size_t count);
+
+    double comm_seconds = 0.0;
+    size_t bytes_sent = 0;
+
+   private:
+    Transport& m_transport;
+    std::vector<float> m_flat;     // all gradients back to back
+    std::vector<float> m_scratch;  // one incoming chunk
+};
+
+// Train_batch_imgs for one rank of a data-parallel job. Every rank runs the same number of
+// steps (the smallest shard decides) so the collective calls stay in lockstep.
+void Train_batch_imgs(NeuralNetwork* net, const Dataset& shard, int batch_size, TrainState& state,
+                      DataParallel& dp, Pruner* pruner = nullptr);
+
+// Fork `world` trainer processes connected by the chosen transport and run `fn` in each.
+// Returns 0 when every rank exits with 0; if one rank fails the others are terminated.
+int launch_data_parallel(int world, TransportKind kind,
+                         const std::function<int(Transport&)>& fn);
@@ -0,0 +1,82 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "../Trace/trace.h"
+#include "data_parallel.h"
+
+int launch_data_parallel(int world, TransportKind kind,
+                         const std::function<int(Transport&)>& fn) {
+    namespace fs = std::filesystem;
+
+    std::string job = "mnist-" + std::to_string(getpid());
+    std::string shm_name = "/" + job;
+    fs::path sock_dir = fs::temp_directory_path() / job;
+
+    if (kind == TransportKind::Shm) {
+        create_shm_segment(shm_name, world);
+    } else {
+        fs::create_directories(sock_dir);
+    }
+
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    std::vector<pid_t> pids;
+    for (int r = 0; r < world; r++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::perror("fork");
+            for (pid_t p : pids) kill(p, SIGTERM);
+            break;
+        }
+
+        if (pid == 0) {
+            int code;
+            try {
+                auto transport = kind == TransportKind::Shm
+                                     ? make_shm_transport(shm_name, r, world)
+                                     : make_socket_transport(sock_dir.string(), r, world);
+                code = fn(*transport);
+            } catch (const std::exception& e) {
+                std::cerr << "[rank " << r << "] " << e.what() << "\n";
+                code = 1;
+            }
+            trace_stop();  // _exit skips the atexit writer
+            std::cout.flush();
+            std::fflush(nullptr);
+            _exit(code);
+        }
+        pids.push_back(pid);
+    }
+
+    int failed = (int)pids.size() != world;
+    for (size_t remaining = pids.size(); remaining > 0; remaining--) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!ok && !failed) {
+            // the surviving ranks would block forever in the next collective
+            std::cerr << "Trainer process " << pid << " failed, stopping the job\n";
+            for (pid_t p : pids)
+                if (p != pid) kill(p, SIGTERM);
+            failed = 1;
+        }
+    }
+
+    if (kind == TransportKind::Shm) {
+        remove_shm_segment(shm_name);
+    } else {
+        std::error_code ec;
+        fs::remove_all(sock_dir, ec);
+    }
+
+    return failed;
+}
@@ -0,0 +1,140 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "transport.h"
+
+namespace {
+
+constexpr size_t CHANNEL_CAPACITY = 4 << 20;  // bytes of payload per ring edge
+
+// head is only written by the producer and tail only by the consumer; both count bytes
+// since the start so head - tail is the fill level.
+struct ChannelHeader {
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm channels need lock-free atomics");
+
+constexpr size_t CHANNEL_STRIDE = sizeof(ChannelHeader) + CHANNEL_CAPACITY;
+
+size_t segment_size(int world) { return CHANNEL_STRIDE * world; }
+
+class ShmTransport : public Transport {
+   public:
+    ShmTransport(const std::string& name, int rank, int world) : Transport(rank, world) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0) throw std::runtime_error("shm_open failed for " + name);
+
+        m_size = segment_size(world);
+        m_base = static_cast<char*>(
+            mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+        close(fd);
+        if (m_base == MAP_FAILED) throw std::runtime_error("mmap failed for " + name);
+
+        // channel r carries rank r -> rank r + 1
+        m_out = m_base + CHANNEL_STRIDE * rank;
+        m_in = m_base + CHANNEL_STRIDE * ((rank - 1 + world) % world);
+    }
+
+    ~ShmTransport() override { munmap(m_base, m_size); }
+
+    void exchange(const void* send_buf, size_t send_bytes, void* recv_buf,
+                  size_t recv_bytes) override {
+        auto* out = reinterpret_cast<ChannelHeader*>(m_out);
+        auto* in = reinterpret_cast<ChannelHeader*>(m_in);
+        char* out_data = m_out + sizeof(ChannelHeader);
+        const char* in_data = m_in + sizeof(ChannelHeader);
+
+        const char* src = static_cast<const char*>(send_buf);
+        char* dst = static_cast<char*>(recv_buf);
+        size_t sent = 0;
+        size_t recvd = 0;
+        int idle = 0;
+
+        while (sent < send_bytes || recvd < recv_bytes) {
+            bool progress = false;
+
+            if (sent < send_bytes) {
+                uint64_t head = out->head.load(std::memory_order_relaxed);
+                uint64_t tail = out->tail.load(std::memory_order_acquire);
+                size_t n = std::min<size_t>(CHANNEL_CAPACITY - (head - tail), send_bytes - sent);
+                if (n > 0) {
+                    copy_in(out_data, head, src + sent, n);
+                    out->head.store(head + n, std::memory_order_release);
+                    sent += n;
+                    progress = true;
+                }
+            }
+
+            if (recvd < recv_bytes) {
+                uint64_t tail = in->tail.load(std::memory_order_relaxed);
+                uint64_t head = in->head.load(std::memory_order_acquire);
+                size_t n = std::min<size_t>(head - tail, recv_bytes - recvd);
+                if (n > 0) {
+                    copy_out(in_data, tail, dst + recvd, n);
+                    in->tail.store(tail + n, std::memory_order_release);
+                    recvd += n;
+                    progress = true;
+                }
+            }
+
+            if (progress) {
+                idle = 0;
+            } else if (++idle > 1000) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+   private:
+    static void copy_in(char* ring, uint64_t pos, const char* src, size_t n) {
+        size_t off = pos % CHANNEL_CAPACITY;
+        size_t first = std::min(n, CHANNEL_CAPACITY - off);
+        std::memcpy(ring + off, src, first);
+        std::memcpy(ring, src + first, n - first);
+    }
+
+    static void copy_out(const char* ring, uint64_t pos, char* dst, size_t n) {
+        size_t off = pos % CHANNEL_CAPACITY;
+        size_t first = std::min(n, CHANNEL_CAPACITY - off);
+        std::memcpy(dst, ring + off, first);
+        std::memcpy(dst + first, ring, n - first);
+    }
+
+    char* m_base = nullptr;
+    size_t m_size = 0;
+    char* m_out = nullptr;
+    char* m_in = nullptr;
+};
+
+}  // namespace
+
+void create_shm_segment(const std::string& name, int world) {
+    shm_unlink(name.c_str());
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) throw std::runtime_error("shm_open failed for " + name);
+
+    // ftruncate zero-fills, which is the empty state of every channel
+    if (ftruncate(fd, segment_size(world)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("ftruncate failed for " + name);
+    }
+    close(fd);
+}
+
+void remove_shm_segment(const std::string& name) { shm_unlink(name.c_str()); }
+
+std::unique_ptr<Transport> make_shm_transport(const std::string& name, int rank, int world) {
+    return std::make_unique<ShmTransport>(name, rank, world);
+}
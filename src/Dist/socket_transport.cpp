@@ -0,0 +1,119 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "transport.h"
+
+namespace {
+
+sockaddr_un socket_address(const std::string& dir, int rank) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::string path = dir + "/rank" + std::to_string(rank) + ".sock";
+    if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path too long");
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+void set_nonblocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); }
+
+class SocketTransport : public Transport {
+   public:
+    SocketTransport(const std::string& dir, int rank, int world) : Transport(rank, world) {
+        sockaddr_un self = socket_address(dir, rank);
+        unlink(self.sun_path);
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind(listener, (sockaddr*)&self, sizeof(self)) != 0 ||
+            listen(listener, 1) != 0) {
+            throw std::runtime_error(std::string("listen failed: ") + std::strerror(errno));
+        }
+
+        // the right neighbour may not be listening yet
+        sockaddr_un right = socket_address(dir, (rank + 1) % world);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        for (;;) {
+            m_out = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (connect(m_out, (sockaddr*)&right, sizeof(right)) == 0) break;
+            close(m_out);
+            if (std::chrono::steady_clock::now() > deadline)
+                throw std::runtime_error("timed out connecting to rank " +
+                                         std::to_string((rank + 1) % world));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        m_in = accept(listener, nullptr, nullptr);
+        close(listener);
+        unlink(self.sun_path);
+        if (m_in < 0) throw std::runtime_error("accept failed");
+
+        set_nonblocking(m_out);
+        set_nonblocking(m_in);
+    }
+
+    ~SocketTransport() override {
+        close(m_out);
+        close(m_in);
+    }
+
+    void exchange(const void* send_buf, size_t send_bytes, void* recv_buf,
+                  size_t recv_bytes) override {
+        const char* src = static_cast<const char*>(send_buf);
+        char* dst = static_cast<char*>(recv_buf);
+        size_t sent = 0;
+        size_t recvd = 0;
+
+        while (sent < send_bytes || recvd < recv_bytes) {
+            // finished directions are left out: a neighbour that is already done with this
+            // exchange may close its end
+            pollfd fds[2] = {{sent < send_bytes ? m_out : -1, POLLOUT, 0},
+                             {recvd < recv_bytes ? m_in : -1, POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("poll failed");
+            }
+
+            if (fds[0].revents & (POLLERR | POLLHUP) || fds[1].revents & POLLERR)
+                throw std::runtime_error("peer connection lost");
+
+            if (fds[0].revents & POLLOUT) {
+                ssize_t n = send(m_out, src + sent, send_bytes - sent, MSG_NOSIGNAL);
+                if (n > 0) {
+                    sent += n;
+                } else if (n < 0 && errno != EAGAIN) {
+                    throw std::runtime_error("send failed");
+                }
+            }
+
+            if (fds[1].revents & (POLLIN | POLLHUP)) {
+                ssize_t n = recv(m_in, dst + recvd, recv_bytes - recvd, 0);
+                if (n > 0) {
+                    recvd += n;
+                } else if (n == 0) {
+                    throw std::runtime_error("peer closed connection");
+                } else if (errno != EAGAIN) {
+                    throw std::runtime_error("recv failed");
+                }
+            }
+        }
+    }
+
+   private:
+    int m_out = -1;
+    int m_in = -1;
+};
+
+}  // namespace
+
+std::unique_ptr<Transport> make_socket_transport(const std::string& dir, int rank, int world) {
+    return std::make_unique<SocketTransport>(dir, rank, world);
+}
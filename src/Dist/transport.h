@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Ring transport between the trainer processes of one job.
+// Rank r only ever talks to its neighbours: it sends to (r + 1) % world and receives from
+// (r - 1 + world) % world, which is all a ring allreduce needs.
+class Transport {
+   public:
+    Transport(int rank, int world) : m_rank(rank), m_world(world) {}
+    virtual ~Transport() = default;
+
+    // Send to the right neighbour and receive from the left one at the same time.
+    // Both directions make progress together, so every rank can call this in lockstep
+    // without deadlocking on bounded buffers.
+    virtual void exchange(const void* send_buf, size_t send_bytes, void* recv_buf,
+                          size_t recv_bytes) = 0;
+
+    int rank() const { return m_rank; }
+    int world() const { return m_world; }
+
+   protected:
+    int m_rank;
+    int m_world;
+};
+
+enum class TransportKind { Shm, Socket };
+
+// POSIX shared memory: one single-producer / single-consumer byte ring per ring edge.
+// The segment has to exist before the ranks attach (see create_shm_segment).
+void create_shm_segment(const std::string& name, int world);
+void remove_shm_segment(const std::string& name);
+std::unique_ptr<Transport> make_shm_transport(const std::string& name, int rank, int world);
+
+// Unix-domain sockets under `dir`: every rank listens on rank<r>.sock and connects to its
+// right neighbour. Same interface, so it can stand in for a cross-host transport.
+std::unique_ptr<Transport> make_socket_transport(const std::string& dir, int rank, int world);
@@ -1,52 +1,91 @@
 #include "Filer.h"
-std::vector<Filer::Img> Filer::get_data(const std::string& filename, int nums) {
-    std::ifstream file(filename);
 
+#include <algorithm>
+#include <atomic>
+#include <string_view>
+
+#include "Data/csv.h"
+#include "Data/mapped_file.h"
+#include "Data/parallel_for.h"
+#include "Trace/trace.h"
+
+// ---------------------------------------------------------------
+// Chunked CSV parsing: the file is mmap'ed, line starts are found with memchr and
+// the lines are parsed with std::from_chars on several threads straight into their
+// destination tensors.
+// ---------------------------------------------------------------
+
+std::vector<Filer::Img> Filer::get_data(const std::string& filename, int nums, int shard,
+                                        int num_shards) {
+    TRACE_SCOPE("Filer::get_data");
     std::vector<Filer::Img> Imgs;
-    if (!file.is_open()) {
+
+    MappedFile file;
+    if (!file.open(filename)) {
         std::cerr << "File failed to open " << filename << std::endl;
         return Imgs;
     }
+    file.advise_sequential();
 
-    std::string line;
-    std::getline(file, line);
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
 
-    bool has_label = line.find("label") != std::string::npos;
+    CsvLine header;
+    p = csv_next_line(p, end, header);
+    std::string_view header_text(header.begin, header.end - header.begin);
+    bool has_label = header_text.find("label") != std::string::npos;
 
-    int count = 0;
-    while (count < nums && std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string item;
+    constexpr int PIXELS = 28 * 28;
 
-        Filer::Img img;
-        std::vector<float> pixels;
+    struct Row {
+        CsvLine line;
+        Img img;
+        int fields = 0;
+    };
 
-        // --- LABEL ---
-        if (has_label) {
-            std::getline(ss, item, ',');
-            img.label = std::stoi(item);
-        }
-
-        // --- PIXELS ---
-        while (std::getline(ss, item, ',')) {
-            pixels.push_back(std::stof(item));
-        }
-
-        if (pixels.size() != 28 * 28) {
-            std::cerr << "Warning: invalid pixel count at row " << count
-                      << " count = " << pixels.size() << std::endl;
-            continue;
+    int count = 0;
+    int skipped = 0;
+    long row = 0;
+
+    // Rows with a bad pixel count do not count towards `nums`, so keep going until enough
+    // good rows were read or the file ends.
+    while (count + skipped < nums && p < end) {
+        std::vector<Row> batch;
+        for (int need = nums - count - skipped; need > 0 && p < end;) {
+            CsvLine line;
+            p = csv_next_line(p, end, line);
+            if (line.begin == line.end) continue;  // blank line
+
+            if (num_shards > 1 && row++ % num_shards != shard) {
+                skipped++;
+                need--;
+                continue;
+            }
+            batch.push_back({line, Img{}, 0});
+            need--;
         }
 
-        // Allocate Tensor 28x28 using unique_ptr
-        img.img_data = std::make_unique<Tensor>(28, 28);
-
-        for (int i = 0; i < 28 * 28; ++i) {
-            img.img_data->h_data[i] = pixels[i] / 255.0f;
+        parallel_for(batch.size(), 256, [&](size_t i) {
+            Row& r = batch[i];
+            const char* q = r.line.begin;
+
+            if (has_label && !csv_field(q, r.line.end, r.img.label)) {
+                r.fields = -1;
+                return;
+            }
+            r.img.img_data = std::make_unique<Tensor>(28, 28);
+            r.fields = csv_floats(q, r.line.end, r.img.img_data->h_data, PIXELS, 255.0f);
+        });
+
+        for (Row& r : batch) {
+            if (r.fields != PIXELS) {
+                std::cerr << "Warning: invalid pixel count at row " << count
+                          << " count = " << std::max(0, r.fields) << std::endl;
+                continue;
+            }
+            Imgs.push_back(std::move(r.img));
+            count++;
         }
-
-        Imgs.push_back(std::move(img));
-        count++;
     }
 
     std::cout << "Loaded " << Imgs.size() << " MNIST rows from " << filename << std::endl;
@@ -114,34 +153,125 @@ void Filer::save_tensor(const Tensor* t, const std::string& file_name) {
 }
 
 std::unique_ptr<Tensor> Filer::load_tensor(const std::string& file_name) {
-    std::ifstream file(file_name);
-
-    if (!file.is_open()) {
+    MappedFile file;
+    if (!file.open(file_name)) {
         std::cerr << "Failed to open tensor file: " << file_name << "\n";
         return nullptr;
     }
 
-    std::string header;
-    std::getline(file, header);
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
 
-    int rows, cols;
-    sscanf(header.c_str(), "%d,%d", &rows, &cols);
+    CsvLine header;
+    p = csv_next_line(p, end, header);
 
-    auto t = std::make_unique<Tensor>(rows, cols);
+    int rows = 0, cols = 0;
+    const char* h = header.begin;
+    if (!csv_field(h, header.end, rows) || !csv_field(h, header.end, cols) || rows <= 0 ||
+        cols <= 0) {
+        std::cerr << "Invalid tensor header in " << file_name << "\n";
+        return nullptr;
+    }
 
+    std::vector<CsvLine> lines(rows);
     for (int r = 0; r < rows; ++r) {
-        std::string line;
-        std::getline(file, line);
+        if (p >= end) {
+            std::cerr << "Tensor file " << file_name << " has fewer than " << rows << " rows\n";
+            return nullptr;
+        }
+        p = csv_next_line(p, end, lines[r]);
+    }
 
-        std::stringstream ss(line);
-        std::string num;
+    auto t = std::make_unique<Tensor>(rows, cols);
 
-        for (int c = 0; c < cols; ++c) {
-            std::getline(ss, num, ',');
-            t->h_data[r * cols + c] = std::stof(num);
-        }
+    std::atomic<int> bad_row{-1};
+    parallel_for(rows, 16, [&](size_t r) {
+        const CsvLine& line = lines[r];
+        if (csv_floats(line.begin, line.end, t->h_data + r * cols, cols, 1.0f) != cols)
+            bad_row = r;
+    });
+
+    if (bad_row >= 0) {
+        std::cerr << "Invalid row " << bad_row << " in tensor file " << file_name << "\n";
+        return nullptr;
+    }
+    return t;
+}
+
+// Sparse layout on disk:
+//   "CSR1" | int32 rows | int32 cols | int32 nnz | row_ptr[rows + 1] | col_idx[nnz] | values[nnz]
+static const char SPARSE_MAGIC[4] = {'C', 'S', 'R', '1'};
+
+void Filer::save_sparse_tensor(const SparseTensor* t, const std::string& file_name) {
+    std::ofstream file(file_name, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "File failed to open: " << file_name << "\n";
+        return;
     }
 
+    int32_t header[3] = {t->rows, t->cols, t->nnz()};
+    file.write(SPARSE_MAGIC, sizeof(SPARSE_MAGIC));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(t->row_ptr.data()),
+               t->row_ptr.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char*>(t->col_idx.data()),
+               t->col_idx.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char*>(t->values.data()), t->values.size() * sizeof(float));
+
     file.close();
+}
+
+std::unique_ptr<SparseTensor> Filer::load_sparse_tensor(const std::string& file_name) {
+    std::ifstream file(file_name, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "Failed to open sparse tensor file: " << file_name << "\n";
+        return nullptr;
+    }
+
+    char magic[4];
+    int32_t header[3];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    if (!file || std::memcmp(magic, SPARSE_MAGIC, sizeof(magic)) != 0 || header[0] <= 0 ||
+        header[1] <= 0 || header[2] < 0) {
+        std::cerr << "Invalid sparse tensor file: " << file_name << "\n";
+        return nullptr;
+    }
+
+    auto t = std::make_unique<SparseTensor>();
+    t->rows = header[0];
+    t->cols = header[1];
+    t->row_ptr.resize(t->rows + 1);
+    t->col_idx.resize(header[2]);
+    t->values.resize(header[2]);
+
+    file.read(reinterpret_cast<char*>(t->row_ptr.data()), t->row_ptr.size() * sizeof(int32_t));
+    file.read(reinterpret_cast<char*>(t->col_idx.data()), t->col_idx.size() * sizeof(int32_t));
+    file.read(reinterpret_cast<char*>(t->values.data()), t->values.size() * sizeof(float));
+
+    if (!file) {
+        std::cerr << "Truncated sparse tensor file: " << file_name << "\n";
+        return nullptr;
+    }
+
+    // the kernels index col_idx / values through row_ptr without further checks
+    bool rows_ok = t->row_ptr.front() == 0 && t->row_ptr.back() == header[2];
+    for (int r = 0; rows_ok && r < t->rows; r++)
+        rows_ok = t->row_ptr[r] <= t->row_ptr[r + 1] && t->row_ptr[r + 1] <= header[2];
+    if (!rows_ok) {
+        std::cerr << "Row pointers are not monotonic within [0, nnz] in: " << file_name << "\n";
+        return nullptr;
+    }
+
+    for (int32_t c : t->col_idx) {
+        if (c < 0 || c >= t->cols) {
+            std::cerr << "Column index out of range in: " << file_name << "\n";
+            return nullptr;
+        }
+    }
+
     return t;
 }
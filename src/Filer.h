@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "../src/Tensor/sparse_tensor.h"
 #include "../src/Tensor/tensor.h"
 
 class Filer {
@@ -19,12 +20,19 @@ class Filer {
     Filer(const std::string& fname) : m_filename(fname) {}
     Filer() {}
 
-    std::vector<Filer::Img> get_data(const std::string& filename, int nums);
+    // shard / num_shards keep every num_shards-th row of the first `nums` rows, starting at
+    // row `shard`, so data-parallel ranks read disjoint parts of one file
+    std::vector<Filer::Img> get_data(const std::string& filename, int nums, int shard = 0,
+                                     int num_shards = 1);
 
     std::unique_ptr<Tensor> load_single_image(const std::string& filename);
     void save_tensor(const Tensor* t, const std::string& file_name);
     std::unique_ptr<Tensor> load_tensor(const std::string& file_name);
 
+    // binary CSR export for pruned layers
+    void save_sparse_tensor(const SparseTensor* t, const std::string& file_name);
+    std::unique_ptr<SparseTensor> load_sparse_tensor(const std::string& file_name);
+
    private:
     std::string m_filename;
 };
@@ -0,0 +1,120 @@
+#include "batching_predictor.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+BatchingPredictor::BatchingPredictor(std::shared_ptr<const InferenceModel> model,
+                                     const BatchingOptions& opts)
+    : m_model(std::move(model)), m_opts(opts) {
+    m_opts.max_batch = std::max(1, m_opts.max_batch);
+    m_opts.threads = std::max(1, m_opts.threads);
+
+    m_histogram = std::make_unique<std::atomic<long>[]>(m_opts.max_batch + 1);
+    for (int i = 0; i <= m_opts.max_batch; i++) m_histogram[i] = 0;
+
+    for (int t = 0; t < m_opts.threads; t++) m_threads.emplace_back(&BatchingPredictor::run, this);
+}
+
+BatchingPredictor::~BatchingPredictor() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads) t.join();
+}
+
+std::future<std::vector<float>> BatchingPredictor::predict(const float* input) {
+    Request req;
+    req.input.assign(input, input + m_model->input_size());
+    std::future<std::vector<float>> result = req.result.get_future();
+
+    size_t queued;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        req.queued = std::chrono::steady_clock::now();
+        m_queue.push_back(std::move(req));
+        queued = m_queue.size();
+    }
+    // the first request starts a runner's wait, a full batch ends it early
+    if (queued == 1 || (int)queued >= m_opts.max_batch) m_cv.notify_one();
+    return result;
+}
+
+void BatchingPredictor::run() {
+    const int in = m_model->input_size();
+    const int out = m_model->output_size();
+    std::vector<Request> batch;
+    std::vector<float> x, y;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) return;  // stopping and drained
+
+            // wait for a full batch, but no longer than the oldest request allows
+            auto deadline = m_queue.front().queued + m_opts.max_wait;
+            m_cv.wait_until(lock, deadline, [&] {
+                return m_stop || m_queue.empty() || (int)m_queue.size() >= m_opts.max_batch;
+            });
+            if (m_queue.empty()) continue;  // another runner took them
+
+            int n = std::min((int)m_queue.size(), m_opts.max_batch);
+            batch.clear();
+            for (int i = 0; i < n; i++) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+            if (!m_queue.empty()) m_cv.notify_one();  // leftovers start the next wait
+        }
+
+        int n = (int)batch.size();
+        x.resize((size_t)n * in);
+        y.resize((size_t)n * out);
+        for (int i = 0; i < n; i++)
+            std::copy(batch[i].input.begin(), batch[i].input.end(), x.begin() + (size_t)i * in);
+
+        m_model->run(x.data(), n, y.data());
+        m_histogram[n]++;
+
+        for (int i = 0; i < n; i++) {
+            const float* p = y.data() + (size_t)i * out;
+            batch[i].result.set_value(std::vector<float>(p, p + out));
+        }
+    }
+}
+
+std::vector<long> BatchingPredictor::histogram() const {
+    std::vector<long> h(m_opts.max_batch + 1);
+    for (int i = 0; i <= m_opts.max_batch; i++) h[i] = m_histogram[i];
+    return h;
+}
+
+long BatchingPredictor::batches() const {
+    long total = 0;
+    for (long c : histogram()) total += c;
+    return total;
+}
+
+long BatchingPredictor::requests() const {
+    std::vector<long> h = histogram();
+    long total = 0;
+    for (size_t n = 0; n < h.size(); n++) total += h[n] * (long)n;
+    return total;
+}
+
+void BatchingPredictor::print_stats(std::ostream& out) const {
+    std::vector<long> h = histogram();
+    long b = batches();
+    out << "Batching: " << requests() << " requests in " << b << " batches";
+    if (b) out << " (mean " << std::fixed << std::setprecision(1) << (double)requests() / b << ")";
+    out << "\n";
+
+    for (size_t n = 1; n < h.size(); n++) {
+        if (!h[n]) continue;
+        out << "  batch " << std::setw(4) << n << ": " << std::setw(8) << h[n] << "\n";
+    }
+    out << std::defaultfloat;
+}
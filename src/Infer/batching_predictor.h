@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "inference_model.h"
+
+struct BatchingOptions {
+    int max_batch = 64;                       // run as soon as this many requests wait
+    std::chrono::microseconds max_wait{200};  // ... or once the oldest one waited this long
+    int threads = 1;                          // concurrent batches, at most the model's arenas
+};
+
+// Coalesces concurrent single-sample requests into batched forward passes.
+//
+// predict() copies the sample into a queue and returns a future. A runner thread takes the
+// queue once it holds max_batch samples or its oldest sample is max_wait old, runs them as one
+// InferenceModel::run() call and fulfils the futures. A small max_wait favours latency, a
+// large one (together with max_batch) throughput; a lone caller pays at most max_wait.
+class BatchingPredictor {
+   public:
+    explicit BatchingPredictor(std::shared_ptr<const InferenceModel> model,
+                               const BatchingOptions& opts = {});
+    ~BatchingPredictor();  // answers everything still queued
+
+    BatchingPredictor(const BatchingPredictor&) = delete;
+    BatchingPredictor& operator=(const BatchingPredictor&) = delete;
+
+    // input: input_size() floats; the future holds output_size() probabilities
+    std::future<std::vector<float>> predict(const float* input);
+
+    const InferenceModel& model() const { return *m_model; }
+    const BatchingOptions& options() const { return m_opts; }
+
+    // histogram()[n] = number of forward passes that ran n samples (n in 1..max_batch)
+    std::vector<long> histogram() const;
+    long batches() const;
+    long requests() const;
+    void print_stats(std::ostream& out) const;
+
+   private:
+    struct Request {
+        std::vector<float> input;
+        std::promise<std::vector<float>> result;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    void run();
+
+    std::shared_ptr<const InferenceModel> m_model;
+    BatchingOptions m_opts;
+
+    std::deque<Request> m_queue;
+    bool m_stop = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<std::thread> m_threads;
+
+    std::unique_ptr<std::atomic<long>[]> m_histogram;  // max_batch + 1 buckets
+};
@@ -0,0 +1,64 @@
+#define MNIST_INFER_BUILD
+#include "../../include/mnist_infer.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "model_file.h"
+
+struct mnist_model {
+    std::unique_ptr<InferenceModel> model;
+};
+
+// samples converted to floats per run() call, so the scratch buffer stays small
+static constexpr int CHUNK = 256;
+
+mnist_model* mnist_model_open(const char* path) {
+    if (!path) return nullptr;
+    try {
+        auto model = open_model_file(path, CHUNK, 0);
+        if (!model) return nullptr;
+        return new mnist_model{std::move(model)};
+    } catch (const std::exception& e) {
+        std::cerr << "mnist_model_open: " << e.what() << "\n";
+        return nullptr;
+    }
+}
+
+void mnist_model_close(mnist_model* model) { delete model; }
+
+int mnist_model_input_size(const mnist_model* model) {
+    return model ? model->model->input_size() : -1;
+}
+
+int mnist_model_output_size(const mnist_model* model) {
+    return model ? model->model->output_size() : -1;
+}
+
+int mnist_predict_batch(const mnist_model* model, const uint8_t* pixels, int n,
+                        float* probs_out) {
+    if (!model || n < 0 || (n > 0 && (!pixels || !probs_out))) return -1;
+
+    const InferenceModel& m = *model->model;
+    const int in = m.input_size();
+    const int out = m.output_size();
+
+    try {
+        static thread_local std::vector<float> x;
+        x.resize((size_t)CHUNK * in);
+
+        for (int start = 0; start < n; start += CHUNK) {
+            int count = std::min(CHUNK, n - start);
+            const uint8_t* src = pixels + (size_t)start * in;
+            for (size_t i = 0; i < (size_t)count * in; i++) x[i] = src[i] / 255.0f;
+            m.run(x.data(), count, probs_out + (size_t)start * out);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "mnist_predict_batch: " << e.what() << "\n";
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <cstring>
+#include <iostream>
+
+#include "../NN/neural_network.h"
+#include "inference_model.h"
+#include "model_file.h"
+
+std::unique_ptr<InferenceModel> Freeze(const NeuralNetwork* net, int max_batch, int max_threads) {
+    std::vector<const float*> weights;
+    std::vector<const float*> biases;
+
+    // the packer reads layers[i+1] x layers[i] floats per layer, whatever the tensors hold
+    if (net->layers.size() < 2 || net->weights.size() != net->layers.size() - 1 ||
+        net->biases.size() != net->weights.size()) {
+        std::cerr << "Freeze: network has " << net->weights.size() << " weight tensors for "
+                  << net->layers.size() << " layer sizes\n";
+        return nullptr;
+    }
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        const Tensor* W = net->weights[i].get();
+        const Tensor* b = net->biases[i].get();
+        int in = net->layers[i], out = net->layers[i + 1];
+        if (!W || !b || W->rows != out || W->cols != in || b->rows != out || b->cols != 1) {
+            std::cerr << "Freeze: layer " << i << " tensors do not match " << in << " -> " << out
+                      << "\n";
+            return nullptr;
+        }
+    }
+
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        weights.push_back(net->weights[i]->h_data);
+        biases.push_back(net->biases[i]->h_data);
+    }
+    return std::make_unique<InferenceModel>(net->layers, weights, biases, max_batch, max_threads);
+}
+
+bool save_model_file(const NeuralNetwork* net, const std::string& path) {
+    // InferenceModel does the packing
+    auto model = Freeze(net, 1, 1);
+    if (!model) return false;
+    return save_model_file(*model, net->learningRate, path);
+}
+
+NeuralNetwork* load_model_file(const std::string& path) {
+    float learning_rate = 0.0f;
+    auto model = open_model_file(path, 1, 1, &learning_rate);
+    if (!model) return nullptr;
+
+    auto* net = new NeuralNetwork(model->layers(), learning_rate);
+    constexpr int P = InferenceModel::PANEL;
+
+    const auto& packed = model->packed_layers();
+    for (size_t l = 0; l < packed.size(); l++) {
+        const InferenceModel::Layer& layer = packed[l];
+        float* W = net->weights[l]->h_data;
+
+        for (int o = 0; o < layer.out; o++) {
+            const float* panel = layer.panels + (size_t)(o / P) * layer.in * P;
+            for (int k = 0; k < layer.in; k++) W[(size_t)o * layer.in + k] = panel[k * P + o % P];
+        }
+        std::memcpy(net->biases[l]->h_data, layer.bias, layer.out * sizeof(float));
+    }
+    return net;
+}
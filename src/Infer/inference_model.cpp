@@ -0,0 +1,249 @@
+#include "inference_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+static constexpr size_t ALIGN = 64;
+
+static size_t round_up(size_t n, size_t m) { return (n + m - 1) / m * m; }
+
+static float* aligned_floats(size_t count) {
+    size_t bytes = round_up(count * sizeof(float), ALIGN);
+    auto* p = static_cast<float*>(std::aligned_alloc(ALIGN, bytes ? bytes : ALIGN));
+    if (!p) throw std::bad_alloc();
+    std::memset(p, 0, bytes);
+    return p;
+}
+
+InferenceModel::InferenceModel(const std::vector<int>& layers,
+                               const std::vector<const float*>& weights,
+                               const std::vector<const float*>& biases, int max_batch,
+                               int max_threads)
+    : m_layers(layers), m_max_batch(std::max(1, max_batch)), m_max_width(0) {
+    int L = (int)layers.size() - 1;
+    if (L < 1 || (int)weights.size() != L || (int)biases.size() != L)
+        throw std::runtime_error("InferenceModel: layer / tensor count mismatch");
+
+    // one allocation holds every panel and bias
+    size_t total = 0;
+    for (int i = 0; i < L; i++) {
+        size_t padded = round_up(layers[i + 1], PANEL);
+        total += padded * layers[i] + padded;
+    }
+    float* storage = aligned_floats(total);
+    m_storage = std::shared_ptr<const void>(storage, std::free);
+
+    float* cursor = storage;
+    for (int i = 0; i < L; i++) {
+        Layer layer;
+        layer.in = layers[i];
+        layer.out = layers[i + 1];
+        layer.out_padded = (int)round_up(layer.out, PANEL);
+        layer.relu = i < L - 1;
+
+        float* panels = cursor;
+        cursor += (size_t)layer.out_padded * layer.in;
+        float* bias = cursor;
+        cursor += layer.out_padded;
+
+        const float* W = weights[i];
+        for (int o = 0; o < layer.out; o++) {
+            float* panel = panels + (size_t)(o / PANEL) * layer.in * PANEL;
+            int j = o % PANEL;
+            for (int k = 0; k < layer.in; k++) panel[k * PANEL + j] = W[(size_t)o * layer.in + k];
+        }
+        std::memcpy(bias, biases[i], layer.out * sizeof(float));
+
+        layer.panels = panels;
+        layer.bias = bias;
+        m_packed.push_back(layer);
+        m_max_width = std::max(m_max_width, layer.out_padded);
+    }
+
+    init_arenas(max_threads);
+}
+
+InferenceModel::InferenceModel(const std::vector<int>& layers, const std::vector<Layer>& packed,
+                               std::shared_ptr<const void> storage, int max_batch,
+                               int max_threads)
+    : m_layers(layers),
+      m_packed(packed),
+      m_max_batch(std::max(1, max_batch)),
+      m_max_width(0),
+      m_storage(std::move(storage)) {
+    int L = (int)layers.size() - 1;
+    if (L < 1 || (int)packed.size() != L)
+        throw std::runtime_error("InferenceModel: layer / tensor count mismatch");
+
+    for (int i = 0; i < L; i++) {
+        const Layer& layer = packed[i];
+        if (layer.in != layers[i] || layer.out != layers[i + 1] ||
+            layer.out_padded != (int)round_up(layer.out, PANEL) || !layer.panels || !layer.bias)
+            throw std::runtime_error("InferenceModel: packed layer " + std::to_string(i) +
+                                     " does not match the layer sizes");
+        m_max_width = std::max(m_max_width, layer.out_padded);
+    }
+
+    init_arenas(max_threads);
+}
+
+void InferenceModel::init_arenas(int max_threads) {
+    // scratch arenas: two ping-pong activation buffers per concurrent caller
+    m_num_arenas = max_threads > 0 ? max_threads
+                                   : (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t per_buffer = round_up((size_t)m_max_batch * m_max_width, ALIGN / sizeof(float));
+    m_scratch = aligned_floats(per_buffer * 2 * m_num_arenas);
+    m_arenas = std::make_unique<Arena[]>(m_num_arenas);
+    for (int a = 0; a < m_num_arenas; a++) {
+        m_arenas[a].ping = m_scratch + per_buffer * 2 * a;
+        m_arenas[a].pong = m_arenas[a].ping + per_buffer;
+    }
+}
+
+InferenceModel::~InferenceModel() { std::free(m_scratch); }
+
+InferenceModel::Arena& InferenceModel::acquire() const {
+    static thread_local size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+    for (;;) {
+        for (int i = 0; i < m_num_arenas; i++) {
+            Arena& arena = m_arenas[(hint + i) % m_num_arenas];
+            if (!arena.busy.test_and_set(std::memory_order_acquire)) return arena;
+        }
+        std::this_thread::yield();
+    }
+}
+
+// Four floats, one SSE / NEON register. Spelled out because left to itself the
+// auto-vectorizer picks the k loop and gathers every panel row with shuffles.
+typedef float Vec __attribute__((vector_size(16)));
+
+// Y[s][j] = act(bias[j] + sum_k X[s][k] * panel[k * PANEL + j]) for R samples: R * PANEL / 4
+// accumulators plus one panel row stay within the 16 vector registers.
+template <int R>
+static void gemm_tile(const float* X, int ldx, int in, const float* panel, const float* bias,
+                      bool relu, float* Y, int ldy) {
+    constexpr int P = InferenceModel::PANEL;
+    constexpr int NV = P / 4;
+
+    Vec acc[R][NV];
+    Vec b[NV];
+    std::memcpy(b, bias, sizeof b);
+    for (int r = 0; r < R; r++)
+        for (int v = 0; v < NV; v++) acc[r][v] = b[v];
+
+    for (int k = 0; k < in; k++) {
+        Vec w[NV];
+        std::memcpy(w, panel + (size_t)k * P, sizeof w);
+        for (int r = 0; r < R; r++) {
+            float x = X[(size_t)r * ldx + k];
+            for (int v = 0; v < NV; v++) acc[r][v] += x * w[v];
+        }
+    }
+
+    for (int r = 0; r < R; r++) {
+        float out[P];
+        std::memcpy(out, acc[r], sizeof out);
+        float* y = Y + (size_t)r * ldy;
+        for (int j = 0; j < P; j++) y[j] = relu ? std::max(out[j], 0.0f) : out[j];
+    }
+}
+
+// one panel for `batch` samples, TILE at a time
+static void gemm_panel(const float* X, int ldx, int batch, int in, const float* panel,
+                       const float* bias, bool relu, float* Y, int ldy) {
+    constexpr int T = InferenceModel::TILE;
+
+    int s = 0;
+    for (; s + T <= batch; s += T)
+        gemm_tile<T>(X + (size_t)s * ldx, ldx, in, panel, bias, relu, Y + (size_t)s * ldy, ldy);
+    for (; s < batch; s++)
+        gemm_tile<1>(X + (size_t)s * ldx, ldx, in, panel, bias, relu, Y + (size_t)s * ldy, ldy);
+}
+
+static void softmax(const float* z, int classes, float* out) {
+    float maxv = z[0];
+    for (int c = 1; c < classes; c++) maxv = std::max(maxv, z[c]);
+
+    float sum = 0.0f;
+    for (int c = 0; c < classes; c++) {
+        out[c] = std::exp(z[c] - maxv);
+        sum += out[c];
+    }
+    for (int c = 0; c < classes; c++) out[c] /= sum;
+}
+
+void InferenceModel::run_chunk(const float* input, int batch, float* output, Arena& arena) const {
+    const float* x = input;
+    int ldx = input_size();
+    float* bufs[2] = {arena.ping, arena.pong};
+
+    for (size_t i = 0; i < m_packed.size(); i++) {
+        const Layer& layer = m_packed[i];
+        float* y = bufs[i % 2];
+        int ldy = layer.out_padded;
+
+        // every panel runs over one block of samples before the next block starts, so the
+        // block's inputs stay in cache while the layer's weights stream past
+        for (int s = 0; s < batch; s += BLOCK) {
+            int n = std::min(BLOCK, batch - s);
+            for (int p = 0; p < layer.out_padded / PANEL; p++) {
+                gemm_panel(x + (size_t)s * ldx, ldx, n, layer.in,
+                           layer.panels + (size_t)p * layer.in * PANEL, layer.bias + p * PANEL,
+                           layer.relu, y + (size_t)s * ldy + p * PANEL, ldy);
+            }
+        }
+        x = y;
+        ldx = ldy;
+    }
+
+    // softmax epilogue over the real (unpadded) outputs
+    int classes = output_size();
+    for (int s = 0; s < batch; s++)
+        softmax(x + (size_t)s * ldx, classes, output + (size_t)s * classes);
+}
+
+void InferenceModel::run(const float* input, int batch, float* output) const {
+    Arena& arena = acquire();
+
+    for (int start = 0; start < batch; start += m_max_batch) {
+        int n = std::min(m_max_batch, batch - start);
+        run_chunk(input + (size_t)start * input_size(), n, output + (size_t)start * output_size(),
+                  arena);
+    }
+
+    arena.busy.clear(std::memory_order_release);
+}
+
+void InferenceModel::run_layers(const float* input,
+                                std::vector<std::vector<float>>& layer_out) const {
+    Arena& arena = acquire();
+    const float* x = input;
+    float* bufs[2] = {arena.ping, arena.pong};
+
+    layer_out.resize(m_packed.size());
+    for (size_t i = 0; i < m_packed.size(); i++) {
+        const Layer& layer = m_packed[i];
+        float* y = bufs[i % 2];
+
+        for (int p = 0; p < layer.out_padded / PANEL; p++) {
+            gemm_panel(x, layer.in, 1, layer.in, layer.panels + (size_t)p * layer.in * PANEL,
+                       layer.bias + p * PANEL, layer.relu, y + p * PANEL, layer.out_padded);
+        }
+
+        layer_out[i].resize(layer.out);
+        if (layer.relu)
+            std::copy(y, y + layer.out, layer_out[i].begin());
+        else
+            softmax(y, layer.out, layer_out[i].data());
+        x = y;
+    }
+
+    arena.busy.clear(std::memory_order_release);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct NeuralNetwork;
+
+// Immutable, inference-only form of a trained network.
+//
+// Each weight matrix (out x in) is repacked once into panels of PANEL output units, stored
+// k-major (panel[k * PANEL + j] = W[p * PANEL + j][k]), so the GEMM micro-kernel streams one
+// contiguous 64-byte row of weights per input feature. Biases seed the accumulators and ReLU
+// runs in the kernel epilogue; softmax is a separate pass over the last layer's outputs.
+//
+// run() is thread-safe and does not allocate: every call claims one of the preallocated
+// scratch arenas (one per expected concurrent caller) and batches larger than max_batch are
+// processed in chunks.
+class InferenceModel {
+   public:
+    static constexpr int PANEL = 16;  // output units per packed panel
+    static constexpr int TILE = 2;    // samples per micro-kernel tile
+    static constexpr int BLOCK = 16;  // samples per cache block, all panels run over it
+
+    struct Layer {
+        int in = 0;
+        int out = 0;
+        int out_padded = 0;             // out rounded up to PANEL
+        const float* panels = nullptr;  // out_padded / PANEL panels of in * PANEL floats
+        const float* bias = nullptr;    // out_padded floats, zero padded
+        bool relu = true;               // false for the softmax output layer
+    };
+
+    // weights[i] is row-major (layers[i + 1] x layers[i]), biases[i] has layers[i + 1] floats
+    InferenceModel(const std::vector<int>& layers, const std::vector<const float*>& weights,
+                   const std::vector<const float*>& biases, int max_batch = 256,
+                   int max_threads = 0);
+    // Already packed layers whose panels and biases live in `storage` (e.g. a mapped model
+    // file, see model_file.h); nothing is copied and `storage` is kept alive by the model.
+    InferenceModel(const std::vector<int>& layers, const std::vector<Layer>& packed,
+                   std::shared_ptr<const void> storage, int max_batch = 256, int max_threads = 0);
+    ~InferenceModel();
+
+    InferenceModel(const InferenceModel&) = delete;
+    InferenceModel& operator=(const InferenceModel&) = delete;
+
+    // input: batch x input_size() floats, sample-major
+    // output: batch x output_size() softmax probabilities
+    void run(const float* input, int batch, float* output) const;
+
+    // One sample, keeping every layer's output: layer_out[i] receives the activations of
+    // layer i + 1 (ReLU, softmax for the last). For inspection and visualization; run() is
+    // the fast path.
+    void run_layers(const float* input, std::vector<std::vector<float>>& layer_out) const;
+
+    int input_size() const { return m_layers.front(); }
+    int output_size() const { return m_layers.back(); }
+    int max_batch() const { return m_max_batch; }
+    const std::vector<int>& layers() const { return m_layers; }
+    const std::vector<Layer>& packed_layers() const { return m_packed; }
+
+   private:
+    struct Arena {
+        std::atomic_flag busy = ATOMIC_FLAG_INIT;
+        float* ping = nullptr;
+        float* pong = nullptr;
+    };
+
+    void init_arenas(int max_threads);
+    Arena& acquire() const;
+    void run_chunk(const float* input, int batch, float* output, Arena& arena) const;
+
+    std::vector<int> m_layers;
+    std::vector<Layer> m_packed;
+    int m_max_batch;
+    int m_max_width;
+
+    std::shared_ptr<const void> m_storage;  // owns (or maps) the packed panels and biases
+    int m_num_arenas;
+    std::unique_ptr<Arena[]> m_arenas;
+    float* m_scratch = nullptr;
+};
+
+std::unique_ptr<InferenceModel> Freeze(const NeuralNetwork* net, int max_batch = 256,
+                                       int max_threads = 0);
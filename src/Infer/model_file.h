@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "inference_model.h"
+
+struct NeuralNetwork;
+
+// Single-file binary model, laid out so it can be mmap'ed and run without copying:
+//
+//   offset 0   ModelFileHeader (64 bytes)
+//   offset 64  i32 layers[num_layers]
+//   table      ModelFileTensor[num_tensors], 8-byte aligned
+//   payloads   float32 tensors, each 64-byte aligned
+//
+// Each layer stores its weights already packed into InferenceModel panels
+// (out_padded x in, k-major per panel) followed by its zero-padded bias (out_padded).
+// `checksum` is FNV-1a (over 64-bit words) of every byte after the header.
+struct ModelFileHeader {
+    char magic[4];  // "MNMF"
+    uint32_t version;
+    uint32_t dtype;  // 0 = float32
+    uint32_t panel;  // InferenceModel::PANEL the weights were packed for
+    uint32_t num_layers;
+    uint32_t num_tensors;
+    float learning_rate;
+    uint32_t reserved;
+    uint64_t file_bytes;
+    uint64_t table_offset;
+    uint64_t checksum;
+    uint64_t reserved2;
+};
+
+struct ModelFileTensor {
+    uint32_t layer;
+    uint32_t kind;  // 0 = packed weights, 1 = bias
+    uint32_t rows;
+    uint32_t cols;
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+// Writes the model's packed layers as they are.
+bool save_model_file(const InferenceModel& model, float learning_rate, const std::string& path);
+
+// Maps the file and builds an InferenceModel pointing straight into the mapping.
+// nullptr (with the reason on stderr) if the file is missing, corrupt or was packed for a
+// different PANEL width. The stored learning rate goes to `learning_rate` when given.
+std::unique_ptr<InferenceModel> open_model_file(const std::string& path, int max_batch = 256,
+                                                int max_threads = 0,
+                                                float* learning_rate = nullptr);
+
+// The training side lives in freeze.cpp, so model_file.cpp and inference_model.cpp build
+// without the trainer (see the mnist_infer library).
+bool save_model_file(const NeuralNetwork* net, const std::string& path);
+
+// Unpacks the file into a trainable network (copies).
+NeuralNetwork* load_model_file(const std::string& path);
@@ -0,0 +1,210 @@
+#include "model_watcher.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "../NN/neural_network.h"
+#include "model_file.h"
+
+namespace fs = std::filesystem;
+
+std::unique_ptr<InferenceModel> open_model(const std::string& path, int max_batch,
+                                           int max_threads) {
+    if (fs::path(path).extension() == ".mnm") return open_model_file(path, max_batch, max_threads);
+
+    std::unique_ptr<NeuralNetwork> net(load(path));
+    if (!net) return nullptr;
+    return Freeze(net.get(), max_batch, max_threads);
+}
+
+namespace {
+
+// false (with the reason) if `next` must not replace `prev`
+bool validate(const InferenceModel& next, const InferenceModel* prev, std::string& why) {
+    if (prev && (next.input_size() != prev->input_size() ||
+                 next.output_size() != prev->output_size())) {
+        why = "input / output size changed from " + std::to_string(prev->input_size()) + " -> " +
+              std::to_string(prev->output_size()) + " to " + std::to_string(next.input_size()) +
+              " -> " + std::to_string(next.output_size());
+        return false;
+    }
+
+    // probes: a blank image and a deterministic pattern
+    constexpr int PROBES = 2;
+    std::vector<float> x((size_t)PROBES * next.input_size(), 0.0f);
+    for (int i = 0; i < next.input_size(); i++)
+        x[next.input_size() + i] = (float)((i * 37) % 256) / 255.0f;
+
+    std::vector<float> y((size_t)PROBES * next.output_size());
+    next.run(x.data(), PROBES, y.data());
+
+    for (int p = 0; p < PROBES; p++) {
+        double sum = 0.0;
+        for (int c = 0; c < next.output_size(); c++) {
+            float v = y[(size_t)p * next.output_size() + c];
+            if (!std::isfinite(v)) {
+                why = "non-finite output (NaN / Inf weights?)";
+                return false;
+            }
+            sum += v;
+        }
+        if (std::abs(sum - 1.0) > 1e-3) {
+            why = "probabilities do not sum to 1";
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+ModelWatcher::ModelWatcher(const std::string& path, const WatchOptions& opts)
+    : m_path(fs::absolute(path).lexically_normal().string()), m_opts(opts) {
+    // "dir/" -> "dir", so the parent directory and the name are right
+    if (m_path.size() > 1 && m_path.back() == '/') m_path.pop_back();
+}
+
+ModelWatcher::~ModelWatcher() {
+    if (m_thread.joinable()) {
+        uint64_t one = 1;
+        (void)!write(m_stop_fd, &one, sizeof(one));
+        m_thread.join();
+    }
+    if (m_stop_fd >= 0) close(m_stop_fd);
+}
+
+bool ModelWatcher::start() {
+    if (!reload()) return false;
+
+    m_stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (m_stop_fd < 0) {
+        std::cerr << "ModelWatcher: eventfd failed, not watching " << m_path << "\n";
+        return true;  // the model is loaded, only hot reload is missing
+    }
+    m_thread = std::thread(&ModelWatcher::run, this);
+    return true;
+}
+
+void ModelWatcher::on_reload(Callback fn) {
+    std::lock_guard<std::mutex> lock(m_reload_mutex);
+    m_callback = std::move(fn);
+}
+
+bool ModelWatcher::reload() {
+    std::lock_guard<std::mutex> lock(m_reload_mutex);
+
+    auto start = std::chrono::steady_clock::now();
+    // load() and Freeze() refuse tensors that disagree with the descriptor before anything is
+    // packed; a half-written model can also make the packer throw
+    std::string why = "load failed";
+    std::shared_ptr<const InferenceModel> next;
+    try {
+        next = open_model(m_path, m_opts.max_batch, m_opts.max_threads);
+    } catch (const std::exception& e) {
+        why = e.what();
+    }
+    std::shared_ptr<const InferenceModel> prev = current();
+
+    if (!next || !validate(*next, prev.get(), why)) {
+        std::cerr << "Model " << m_path << " rejected: " << why
+                  << (prev ? ", keeping the current model" : "") << "\n";
+        m_rejected++;
+        return false;
+    }
+
+    // in-flight callers finish on `prev`, it is freed when the last of them lets go
+    std::atomic_store(&m_model, next);
+    m_reloads++;
+
+    double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (prev ? "Reloaded model " : "Loaded model ") << m_path << " in " << ms << " ms"
+              << std::endl;
+
+    if (prev && m_callback) m_callback(next);
+    return true;
+}
+
+// watch the model directory itself (CSV models); after it was renamed over the watch has to
+// be added again for the new directory
+void ModelWatcher::watch_model(int inotify_fd) {
+    if (m_model_wd >= 0) inotify_rm_watch(inotify_fd, m_model_wd);
+    m_model_wd = -1;
+
+    std::error_code ec;
+    if (fs::is_directory(m_path, ec)) {
+        uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+        m_model_wd = inotify_add_watch(inotify_fd, m_path.c_str(), mask);
+    }
+}
+
+void ModelWatcher::run() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "ModelWatcher: inotify unavailable, not watching " << m_path << "\n";
+        return;
+    }
+
+    fs::path model(m_path);
+    std::string name = model.filename().string();
+    int parent_wd = inotify_add_watch(fd, model.parent_path().c_str(),
+                                      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (parent_wd < 0) {
+        std::cerr << "ModelWatcher: cannot watch " << model.parent_path() << "\n";
+        close(fd);
+        return;
+    }
+    watch_model(fd);
+
+    bool pending = false;
+    auto due = std::chrono::steady_clock::now();
+    alignas(inotify_event) char buf[4096];
+
+    for (;;) {
+        int timeout = -1;
+        if (pending) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                due - std::chrono::steady_clock::now());
+            timeout = (int)std::max<long>(0, left.count());
+        }
+
+        pollfd fds[2] = {{fd, POLLIN, 0}, {m_stop_fd, POLLIN, 0}};
+        int n = poll(fds, 2, timeout);
+        if (n < 0 && errno != EINTR) break;
+        if (fds[1].revents & POLLIN) break;
+
+        if (n > 0 && (fds[0].revents & POLLIN)) {
+            ssize_t len;
+            while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len;) {
+                    auto* ev = reinterpret_cast<inotify_event*>(p);
+                    p += sizeof(inotify_event) + ev->len;
+
+                    bool ours = ev->wd == m_model_wd ||
+                                (ev->wd == parent_wd && ev->len && name == ev->name);
+                    if (!ours) continue;
+
+                    // every write restarts the quiet period
+                    pending = true;
+                    due = std::chrono::steady_clock::now() + m_opts.debounce;
+                }
+            }
+            continue;
+        }
+
+        if (pending && std::chrono::steady_clock::now() >= due) {
+            pending = false;
+            reload();
+            watch_model(fd);
+        }
+    }
+
+    close(fd);
+}
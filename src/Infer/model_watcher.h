@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "inference_model.h"
+
+// .mnm files are mapped (open_model_file), anything else is read as a CSV model directory
+// and frozen. nullptr (with the reason on stderr) if it cannot be loaded.
+std::unique_ptr<InferenceModel> open_model(const std::string& path, int max_batch = 256,
+                                           int max_threads = 0);
+
+struct WatchOptions {
+    int max_batch = 256;
+    int max_threads = 0;
+    std::chrono::milliseconds debounce{250};  // quiet time after the last change before loading
+};
+
+// Holds the current model behind an atomically swapped shared_ptr and replaces it when the
+// model on disk changes.
+//
+// A background thread watches the model path with inotify (the file or directory itself and
+// its parent, so atomic renames from save_model_file / save_atomic are seen), waits for the
+// writes to settle, loads the new model and validates it: same input / output sizes as the
+// current one and finite softmax outputs on probe inputs. Only then is it published.
+//
+// current() never blocks on a reload: callers keep the model they got alive for as long as
+// they use it, and a rejected or half-written model is never served.
+// A mapped .mnm must be replaced by rename, not rewritten in place.
+class ModelWatcher {
+   public:
+    using Callback = std::function<void(std::shared_ptr<const InferenceModel>)>;
+
+    explicit ModelWatcher(const std::string& path, const WatchOptions& opts = {});
+    ~ModelWatcher();
+
+    ModelWatcher(const ModelWatcher&) = delete;
+    ModelWatcher& operator=(const ModelWatcher&) = delete;
+
+    // loads the model now and starts watching; false if the first load fails
+    bool start();
+
+    std::shared_ptr<const InferenceModel> current() const { return std::atomic_load(&m_model); }
+
+    // load, validate and publish right away; false keeps the current model
+    bool reload();
+
+    // called on the watcher thread with every newly published model
+    void on_reload(Callback fn);
+
+    const std::string& path() const { return m_path; }
+    int reloads() const { return m_reloads; }
+    int rejected() const { return m_rejected; }
+
+   private:
+    void run();
+    void watch_model(int inotify_fd);
+
+    std::string m_path;
+    WatchOptions m_opts;
+    std::shared_ptr<const InferenceModel> m_model;  // only through atomic_load / atomic_store
+
+    std::mutex m_reload_mutex;  // one reload at a time
+    Callback m_callback;
+
+    std::atomic<int> m_reloads{0};
+    std::atomic<int> m_rejected{0};
+
+    int m_stop_fd = -1;
+    int m_model_wd = -1;
+    std::thread m_thread;
+};
@@ -0,0 +1,205 @@
+#include "checkpoint.h"
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+
+#include "../Trace/trace.h"
+
+namespace {
+
+constexpr char MAGIC[4] = {'M', 'N', 'C', 'K'};
+constexpr uint32_t VERSION = 1;
+
+struct Writer {
+    std::vector<char> bytes;
+
+    void raw(const void* p, size_t n) {
+        const char* c = static_cast<const char*>(p);
+        bytes.insert(bytes.end(), c, c + n);
+    }
+    template <typename T>
+    void put(T v) {
+        raw(&v, sizeof(T));
+    }
+};
+
+struct Reader {
+    const char* p;
+    const char* end;
+
+    bool raw(void* dst, size_t n) {
+        if ((size_t)(end - p) < n) return false;
+        std::memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+    template <typename T>
+    bool get(T& v) {
+        return raw(&v, sizeof(T));
+    }
+};
+
+uint64_t fnv1a(const char* data, size_t n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+}  // namespace
+
+bool save_checkpoint(const NeuralNetwork* net, const TrainState& state,
+                     const std::vector<CheckpointBuffer>& buffers, const std::string& path) {
+    TRACE_SCOPE("save checkpoint");
+    Writer w;
+    w.raw(MAGIC, sizeof(MAGIC));
+    w.put<uint32_t>(VERSION);
+
+    w.put<uint32_t>(net->layers.size());
+    for (int size : net->layers) w.put<int32_t>(size);
+    w.put<float>(net->learningRate);
+
+    w.put<int32_t>(state.epoch);
+    w.put<int64_t>(state.step);
+    w.put<float>(state.best_val);
+
+    std::ostringstream rng;
+    rng << state.rng;
+    std::string rng_text = rng.str();
+    w.put<uint32_t>(rng_text.size());
+    w.raw(rng_text.data(), rng_text.size());
+
+    w.put<uint32_t>(state.order.size());
+    w.raw(state.order.data(), state.order.size() * sizeof(int32_t));
+
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        w.raw(net->weights[i]->h_data, net->weights[i]->size() * sizeof(float));
+        w.raw(net->biases[i]->h_data, net->biases[i]->size() * sizeof(float));
+    }
+
+    w.put<uint32_t>(buffers.size());
+    for (const auto& b : buffers) {
+        w.put<uint32_t>(b.name.size());
+        w.raw(b.name.data(), b.name.size());
+        w.put<uint64_t>(b.data.size());
+        w.raw(b.data.data(), b.data.size());
+    }
+
+    w.put<uint64_t>(fnv1a(w.bytes.data(), w.bytes.size()));
+
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Failed to open checkpoint file: " << tmp << "\n";
+        return false;
+    }
+
+    bool ok = std::fwrite(w.bytes.data(), 1, w.bytes.size(), f) == w.bytes.size();
+    ok = ok && std::fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = std::fclose(f) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write checkpoint: " << path << "\n";
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+NeuralNetwork* load_checkpoint(const std::string& path, TrainState& state,
+                               std::vector<CheckpointBuffer>& buffers) {
+    TRACE_SCOPE("load checkpoint");
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open checkpoint: " << path << "\n";
+        return nullptr;
+    }
+
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+    auto corrupt = [&](const char* what) -> NeuralNetwork* {
+        std::cerr << "Invalid checkpoint " << path << ": " << what << "\n";
+        return nullptr;
+    };
+
+    if (bytes.size() < sizeof(MAGIC) + sizeof(uint64_t)) return corrupt("too short");
+
+    size_t body = bytes.size() - sizeof(uint64_t);
+    uint64_t checksum;
+    std::memcpy(&checksum, bytes.data() + body, sizeof(checksum));
+    if (checksum != fnv1a(bytes.data(), body)) return corrupt("checksum mismatch");
+
+    Reader r{bytes.data(), bytes.data() + body};
+
+    char magic[4];
+    uint32_t version;
+    if (!r.raw(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0) return corrupt("bad magic");
+    if (!r.get(version) || version != VERSION) return corrupt("unsupported version");
+
+    uint32_t L;
+    if (!r.get(L) || L < 2) return corrupt("bad layer count");
+    std::vector<int> layers(L);
+    for (auto& size : layers) {
+        int32_t v;
+        if (!r.get(v) || v <= 0) return corrupt("bad layer size");
+        size = v;
+    }
+
+    float lr;
+    int32_t epoch;
+    int64_t step;
+    float best_val;
+    if (!r.get(lr) || !r.get(epoch) || !r.get(step) || !r.get(best_val))
+        return corrupt("truncated header");
+
+    uint32_t n;
+    if (!r.get(n)) return corrupt("truncated rng state");
+    std::string rng_text(n, '\0');
+    if (!r.raw(rng_text.data(), n)) return corrupt("truncated rng state");
+
+    if (!r.get(n)) return corrupt("truncated order");
+    std::vector<int> order(n);
+    if (!r.raw(order.data(), n * sizeof(int32_t))) return corrupt("truncated order");
+
+    auto net = std::make_unique<NeuralNetwork>(layers, lr);
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        if (!r.raw(net->weights[i]->h_data, net->weights[i]->size() * sizeof(float)) ||
+            !r.raw(net->biases[i]->h_data, net->biases[i]->size() * sizeof(float)))
+            return corrupt("truncated parameters");
+    }
+
+    uint32_t count;
+    if (!r.get(count)) return corrupt("truncated buffers");
+    std::vector<CheckpointBuffer> extra(count);
+    for (auto& b : extra) {
+        uint32_t name_len;
+        uint64_t size;
+        if (!r.get(name_len)) return corrupt("truncated buffers");
+        b.name.resize(name_len);
+        if (!r.raw(b.name.data(), name_len) || !r.get(size)) return corrupt("truncated buffers");
+        b.data.resize(size);
+        if (!r.raw(b.data.data(), size)) return corrupt("truncated buffers");
+    }
+
+    std::istringstream rng(rng_text);
+    std::mt19937 restored;
+    if (!(rng >> restored)) return corrupt("bad rng state");
+
+    state.epoch = epoch;
+    state.step = step;
+    state.best_val = best_val;
+    state.rng = restored;
+    state.order = std::move(order);
+    buffers = std::move(extra);
+
+    std::cout << "Resumed checkpoint " << path << " at epoch " << epoch << ", step " << step
+              << "\n";
+    return net.release();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "neural_network.h"
+
+// Opaque named state saved next to the parameters (optimizer buffers, pruning masks, ...).
+struct CheckpointBuffer {
+    std::string name;
+    std::vector<char> data;
+};
+
+// Binary training checkpoint (little-endian, native float):
+//   "MNCK" | u32 version | u32 L | i32 layers[L] | f32 learning rate
+//   | i32 epoch | i64 step | f32 best_val
+//   | u32 n | rng state as text (std::mt19937 operator<<)
+//   | u32 n | i32 order[n]
+//   | per layer: f32 weights[out * in], f32 biases[out]
+//   | u32 buffers | per buffer: u32 name length, name, u64 size, bytes
+//   | u64 FNV-1a checksum of everything before it
+// Written to <path>.tmp, fsync'ed and renamed over <path>.
+bool save_checkpoint(const NeuralNetwork* net, const TrainState& state,
+                     const std::vector<CheckpointBuffer>& buffers, const std::string& path);
+
+// Returns nullptr (and leaves state untouched) if the file is missing, truncated or corrupt.
+NeuralNetwork* load_checkpoint(const std::string& path, TrainState& state,
+                               std::vector<CheckpointBuffer>& buffers);
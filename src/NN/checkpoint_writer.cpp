@@ -0,0 +1,185 @@
+#include "checkpoint_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+bool save_atomic(const NeuralNetwork* net, const std::string& dir_name) {
+    fs::path dir = fs::absolute(dir_name).lexically_normal();
+    if (dir.filename().empty()) dir = dir.parent_path();
+
+    fs::path tmp = dir;
+    tmp += ".tmp-" + std::to_string(getpid());
+
+    std::error_code ec;
+    fs::remove_all(tmp, ec);
+    if (!save(net, tmp.string(), false)) {
+        fs::remove_all(tmp, ec);
+        return false;
+    }
+
+    if (!fs::exists(dir)) {
+        fs::rename(tmp, dir, ec);
+    } else if (renameat2(AT_FDCWD, tmp.c_str(), AT_FDCWD, dir.c_str(), RENAME_EXCHANGE) == 0) {
+        // tmp now holds the previous model
+        fs::remove_all(tmp, ec);
+    } else {
+        // filesystem without RENAME_EXCHANGE: two renames, the old copy is kept until the end
+        fs::path old = dir;
+        old += ".old";
+        fs::remove_all(old, ec);
+        fs::rename(dir, old, ec);
+        if (!ec) fs::rename(tmp, dir, ec);
+        if (!ec) fs::remove_all(old, ec);
+    }
+
+    if (ec) {
+        std::cerr << "Checkpoint rename failed: " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+CheckpointWriter::CheckpointWriter(const NeuralNetwork* net, int max_in_flight, bool verbose)
+    : m_verbose(verbose) {
+    for (int i = 0; i < std::max(1, max_in_flight); i++) {
+        m_buffers.push_back(std::make_unique<NeuralNetwork>(*net));
+        m_free.push_back(i);
+    }
+    m_thread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+int CheckpointWriter::take_buffer(std::unique_lock<std::mutex>& lock, const std::string& dest) {
+    for (;;) {
+        if (!m_free.empty()) {
+            int b = m_free.back();
+            m_free.pop_back();
+            return b;
+        }
+        auto it = std::find_if(m_pending.begin(), m_pending.end(),
+                               [&](const Job& job) { return job.dir == dest; });
+        if (it != m_pending.end()) {
+            int b = it->buffer;
+            m_pending.erase(it);
+            m_superseded++;
+            return b;
+        }
+        // every buffer is being written or queued for another destination
+        m_cv.wait(lock);
+    }
+}
+
+void CheckpointWriter::save(const NeuralNetwork* net, const std::string& dir_name) {
+    Job job;
+    job.dir = dir_name;
+    enqueue(net, std::move(job));
+}
+
+void CheckpointWriter::save_checkpoint(const NeuralNetwork* net, const TrainState& state,
+                                       const std::vector<CheckpointBuffer>& buffers,
+                                       const std::string& path) {
+    Job job;
+    job.dir = path;
+    job.binary = true;
+    job.state = state;
+    job.extra = buffers;
+    enqueue(net, std::move(job));
+}
+
+void CheckpointWriter::enqueue(const NeuralNetwork* net, Job job) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    int b = take_buffer(lock, job.dir);
+    lock.unlock();
+
+    // the buffer is ours until it is queued again
+    NeuralNetwork& snap = *m_buffers[b];
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        std::memcpy(snap.weights[i]->h_data, net->weights[i]->h_data,
+                    net->weights[i]->size() * sizeof(float));
+        std::memcpy(snap.biases[i]->h_data, net->biases[i]->h_data,
+                    net->biases[i]->size() * sizeof(float));
+    }
+    snap.learningRate = net->learningRate;
+
+    job.buffer = b;
+
+    lock.lock();
+    m_pending.push_back(std::move(job));
+    m_stall_seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    lock.unlock();
+    m_cv.notify_all();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&] { return m_pending.empty() && !m_writing; });
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [&] { return m_stop || !m_pending.empty(); });
+        if (m_pending.empty()) return;  // stopping and drained
+
+        Job job = std::move(m_pending.front());
+        m_pending.pop_front();
+        m_writing = true;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        const NeuralNetwork* snap = m_buffers[job.buffer].get();
+        bool ok = job.binary ? ::save_checkpoint(snap, job.state, job.extra, job.dir)
+                             : save_atomic(snap, job.dir);
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // stderr: this thread must not interleave with the trainer's per-epoch lines on stdout
+        if (ok && m_verbose)
+            std::cerr << "Checkpoint written to " << job.dir << " in " << seconds << " s\n";
+
+        lock.lock();
+        m_writing = false;
+        m_free.push_back(job.buffer);
+        m_write_seconds += seconds;
+        if (ok) m_written++;
+        m_cv.notify_all();
+    }
+}
+
+int CheckpointWriter::written() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_written;
+}
+
+int CheckpointWriter::superseded() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_superseded;
+}
+
+double CheckpointWriter::stall_seconds() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stall_seconds;
+}
+
+double CheckpointWriter::write_seconds() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_write_seconds;
+}
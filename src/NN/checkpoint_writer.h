@@ -0,0 +1,72 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.h"
+#include "neural_network.h"
+
+// Non-blocking save().
+// The training thread only memcpy's the parameters into one of `max_in_flight` preallocated
+// snapshot buffers and returns; a writer thread serializes the snapshot into a temporary
+// directory and swaps it into place, so readers never see a half-written model.
+// When every buffer is taken, the oldest snapshot for the same destination that has not
+// started writing yet is replaced by the new one (a newer best model supersedes it).
+class CheckpointWriter {
+   public:
+    // `verbose` reports every finished write on stderr, like save(..., verbose)
+    explicit CheckpointWriter(const NeuralNetwork* net, int max_in_flight = 2,
+                              bool verbose = true);
+    ~CheckpointWriter();  // writes out everything still queued
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void save(const NeuralNetwork* net, const std::string& dir_name);
+    // same, but writes a resumable binary checkpoint (see checkpoint.h) to `path`
+    void save_checkpoint(const NeuralNetwork* net, const TrainState& state,
+                         const std::vector<CheckpointBuffer>& buffers, const std::string& path);
+    void flush();  // block until every queued snapshot is on disk
+
+    int written() const;
+    int superseded() const;
+    double stall_seconds() const;  // time save() spent on the caller's thread
+    double write_seconds() const;  // time spent writing on the background thread
+
+   private:
+    struct Job {
+        int buffer;
+        std::string dir;
+
+        bool binary = false;  // checkpoint file instead of a model directory
+        TrainState state;
+        std::vector<CheckpointBuffer> extra;
+    };
+
+    void run();
+    int take_buffer(std::unique_lock<std::mutex>& lock, const std::string& dest);
+    void enqueue(const NeuralNetwork* net, Job job);
+
+    std::vector<std::unique_ptr<NeuralNetwork>> m_buffers;
+    std::vector<int> m_free;
+    std::deque<Job> m_pending;
+    bool m_writing = false;
+    bool m_stop = false;
+    bool m_verbose;
+
+    int m_written = 0;
+    int m_superseded = 0;
+    double m_stall_seconds = 0.0;
+    double m_write_seconds = 0.0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+// Write a model directory with save() next to `dir_name` and swap it in with a rename.
+bool save_atomic(const NeuralNetwork* net, const std::string& dir_name);
@@ -0,0 +1,452 @@
+#include "low_rank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <numeric>
+#include <stdexcept>
+
+// ---------------------------------------------------------------
+// Symmetric eigensolver (Householder tridiagonalization + implicit QL)
+// V is n x n row-major; on return its columns hold the eigenvectors and d the
+// eigenvalues in ascending order.
+// ---------------------------------------------------------------
+
+static void tridiagonalize(std::vector<double>& V, std::vector<double>& d, std::vector<double>& e,
+                           int n) {
+    auto v = [&](int r, int c) -> double& { return V[(size_t)r * n + c]; };
+
+    for (int j = 0; j < n; j++) d[j] = v(n - 1, j);
+
+    for (int i = n - 1; i > 0; i--) {
+        double scale = 0.0;
+        double h = 0.0;
+        for (int k = 0; k < i; k++) scale += std::fabs(d[k]);
+
+        if (scale == 0.0) {
+            e[i] = d[i - 1];
+            for (int j = 0; j < i; j++) {
+                d[j] = v(i - 1, j);
+                v(i, j) = 0.0;
+                v(j, i) = 0.0;
+            }
+        } else {
+            for (int k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+            double f = d[i - 1];
+            double g = std::sqrt(h);
+            if (f > 0) g = -g;
+            e[i] = scale * g;
+            h = h - f * g;
+            d[i - 1] = f - g;
+            for (int j = 0; j < i; j++) e[j] = 0.0;
+
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                v(j, i) = f;
+                g = e[j] + v(j, j) * f;
+                for (int k = j + 1; k <= i - 1; k++) {
+                    g += v(k, j) * d[k];
+                    e[k] += v(k, j) * f;
+                }
+                e[j] = g;
+            }
+            f = 0.0;
+            for (int j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+            double hh = f / (h + h);
+            for (int j = 0; j < i; j++) e[j] -= hh * d[j];
+            for (int j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (int k = j; k <= i - 1; k++) v(k, j) -= (f * e[k] + g * d[k]);
+                d[j] = v(i - 1, j);
+                v(i, j) = 0.0;
+            }
+        }
+        d[i] = h;
+    }
+
+    // accumulate the transformations
+    for (int i = 0; i < n - 1; i++) {
+        v(n - 1, i) = v(i, i);
+        v(i, i) = 1.0;
+        double h = d[i + 1];
+        if (h != 0.0) {
+            for (int k = 0; k <= i; k++) d[k] = v(k, i + 1) / h;
+            for (int j = 0; j <= i; j++) {
+                double g = 0.0;
+                for (int k = 0; k <= i; k++) g += v(k, i + 1) * v(k, j);
+                for (int k = 0; k <= i; k++) v(k, j) -= g * d[k];
+            }
+        }
+        for (int k = 0; k <= i; k++) v(k, i + 1) = 0.0;
+    }
+    for (int j = 0; j < n; j++) {
+        d[j] = v(n - 1, j);
+        v(n - 1, j) = 0.0;
+    }
+    v(n - 1, n - 1) = 1.0;
+    e[0] = 0.0;
+}
+
+static void ql_implicit(std::vector<double>& V, std::vector<double>& d, std::vector<double>& e,
+                        int n) {
+    auto v = [&](int r, int c) -> double& { return V[(size_t)r * n + c]; };
+
+    for (int i = 1; i < n; i++) e[i - 1] = e[i];
+    e[n - 1] = 0.0;
+
+    double f = 0.0;
+    double tst1 = 0.0;
+    const double eps = std::pow(2.0, -52.0);
+
+    for (int l = 0; l < n; l++) {
+        tst1 = std::max(tst1, std::fabs(d[l]) + std::fabs(e[l]));
+        int m = l;
+        while (m < n) {
+            if (std::fabs(e[m]) <= eps * tst1) break;
+            m++;
+        }
+
+        if (m > l) {
+            do {
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = std::hypot(p, 1.0);
+                if (p < 0) r = -r;
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (int i = l + 2; i < n; i++) d[i] -= h;
+                f += h;
+
+                p = d[m];
+                double c = 1.0, c2 = c, c3 = c;
+                double el1 = e[l + 1];
+                double s = 0.0, s2 = 0.0;
+                for (int i = m - 1; i >= l; i--) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = std::hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    for (int k = 0; k < n; k++) {
+                        h = v(k, i + 1);
+                        v(k, i + 1) = s * v(k, i) + c * h;
+                        v(k, i) = c * v(k, i) - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (std::fabs(e[l]) > eps * tst1);
+        }
+        d[l] = d[l] + f;
+        e[l] = 0.0;
+    }
+}
+
+LayerSpectrum Tspectrum(const Tensor& W) {
+    int m = W.rows;
+    int n = W.cols;
+
+    LayerSpectrum s;
+    s.left = m <= n;
+    s.dim = std::min(m, n);
+    int k = s.dim;
+
+    // Gram matrix of the smaller side: W W^T (m <= n) or W^T W
+    std::vector<double> G((size_t)k * k, 0.0);
+    if (s.left) {
+        for (int i = 0; i < m; i++)
+            for (int j = i; j < m; j++) {
+                double sum = 0.0;
+                for (int p = 0; p < n; p++) sum += (double)W.h_data[i * n + p] * W.h_data[j * n + p];
+                G[(size_t)i * k + j] = G[(size_t)j * k + i] = sum;
+            }
+    } else {
+        for (int r = 0; r < m; r++) {
+            const float* row = W.h_data + r * n;
+            for (int i = 0; i < n; i++)
+                for (int j = i; j < n; j++) G[(size_t)i * k + j] += (double)row[i] * row[j];
+        }
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < i; j++) G[(size_t)i * k + j] = G[(size_t)j * k + i];
+    }
+
+    std::vector<double> d(k), e(k);
+    tridiagonalize(G, d, e, k);
+    ql_implicit(G, d, e, k);
+
+    // reorder descending: sigma_i = sqrt(lambda_i), basis column i = eigenvector
+    std::vector<int> order(k);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return d[a] > d[b]; });
+
+    s.sigma.resize(k);
+    s.basis.resize((size_t)k * k);
+    for (int c = 0; c < k; c++) {
+        s.sigma[c] = std::sqrt(std::max(d[order[c]], 0.0));
+        for (int r = 0; r < k; r++) s.basis[(size_t)c * k + r] = G[(size_t)r * k + order[c]];
+    }
+    return s;
+}
+
+float spectrum_energy(const LayerSpectrum& s, int rank) {
+    double total = 0.0;
+    double kept = 0.0;
+    for (size_t i = 0; i < s.sigma.size(); i++) {
+        double e = s.sigma[i] * s.sigma[i];
+        total += e;
+        if ((int)i < rank) kept += e;
+    }
+    return total > 0.0 ? (float)(kept / total) : 1.0f;
+}
+
+int rank_for_energy(const LayerSpectrum& s, float energy) {
+    for (int r = 1; r <= s.dim; r++)
+        if (spectrum_energy(s, r) >= energy) return r;
+    return s.dim;
+}
+
+// Projection onto the top-k singular subspace, which is the best rank-k approximation:
+//   m <= n:  A = U_k,      B = U_k^T W
+//   m >  n:  A = W V_k,    B = V_k^T
+void Tfactorize(const Tensor& W, const LayerSpectrum& s, int rank, std::unique_ptr<Tensor>& A,
+                std::unique_ptr<Tensor>& B) {
+    int m = W.rows;
+    int n = W.cols;
+    int k = std::max(1, std::min(rank, s.dim));
+
+    A = std::make_unique<Tensor>(m, k);
+    B = std::make_unique<Tensor>(k, n);
+
+    if (s.left) {
+        for (int c = 0; c < k; c++) {
+            const double* u = s.basis.data() + (size_t)c * s.dim;
+            for (int r = 0; r < m; r++) A->h_data[r * k + c] = (float)u[r];
+
+            for (int j = 0; j < n; j++) {
+                double sum = 0.0;
+                for (int r = 0; r < m; r++) sum += u[r] * W.h_data[r * n + j];
+                B->h_data[c * n + j] = (float)sum;
+            }
+        }
+    } else {
+        for (int c = 0; c < k; c++) {
+            const double* v = s.basis.data() + (size_t)c * s.dim;
+            for (int j = 0; j < n; j++) B->h_data[c * n + j] = (float)v[j];
+
+            for (int r = 0; r < m; r++) {
+                double sum = 0.0;
+                for (int j = 0; j < n; j++) sum += W.h_data[r * n + j] * v[j];
+                A->h_data[r * k + c] = (float)sum;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------
+// Factorized inference
+// ---------------------------------------------------------------
+
+long FactorizedLayer::flops() const {
+    if (A) return 2L * rank() * (A->rows + B->cols);
+    return 2L * W->rows * W->cols;
+}
+
+long FactorizedNetwork::flops() const {
+    long total = 0;
+    for (const auto& l : weights) total += l.flops();
+    return total;
+}
+
+FactorizedNetwork* Factorize(const NeuralNetwork* net, const std::vector<LayerSpectrum>& spectra,
+                             const std::vector<int>& ranks) {
+    if (spectra.size() != net->weights.size() || ranks.size() != net->weights.size())
+        throw std::runtime_error("Factorize needs one spectrum and one rank per layer");
+
+    auto* fn = new FactorizedNetwork();
+    fn->layers = net->layers;
+    fn->learningRate = net->learningRate;
+
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        const Tensor& W = *net->weights[i];
+        FactorizedLayer layer;
+        layer.bias = Tcopy(*net->biases[i]);
+
+        int r = ranks[i];
+        if (r > 0 && r < break_even_rank(W.rows, W.cols)) {
+            Tfactorize(W, spectra[i], r, layer.A, layer.B);
+        } else {
+            layer.W = Tcopy(W);
+        }
+        fn->weights.push_back(std::move(layer));
+    }
+    return fn;
+}
+
+std::unique_ptr<Tensor> predict(FactorizedNetwork* net, Tensor* input) {
+    Tensor* a = input;
+    int L = net->layers.size() - 1;
+
+    std::unique_ptr<Tensor> out;
+
+    for (int i = 0; i < L; i++) {
+        const FactorizedLayer& layer = net->weights[i];
+        auto z = layer.is_factorized() ? Tmatmul(*layer.A, *Tmatmul(*layer.B, *a))
+                                       : Tmatmul(*layer.W, *a);
+        auto z2 = TaddBias(*z, *layer.bias);
+
+        if (i < L - 1) {
+            TRelu(*z2);
+        } else {
+            TSoftmaxCols(*z2);
+        }
+        out = std::move(z2);
+        a = out.get();
+    }
+
+    return out;
+}
+
+float evaluate_accuracy(FactorizedNetwork* net, std::vector<Filer::Img>& dataset, int n) {
+    int correct = 0;
+
+    for (int i = 0; i < n; i++) {
+        auto img = Tflatten(*dataset[i].img_data);
+        auto prediction = predict(net, img.get());
+
+        if (TArgmax(*prediction) == dataset[i].label) correct++;
+    }
+
+    return (float)correct / n;
+}
+
+// Same directory layout as save(); a factorized layer i is stored as weights_i_a.csv (m x k)
+// and weights_i_b.csv (k x n) instead of weights_i.csv.
+void save_factorized(const FactorizedNetwork* net, const std::string& dir_name) {
+    namespace fs = std::filesystem;
+    fs::path dir = dir_name;
+
+    Filer filer;
+    try {
+        fs::create_directories(dir);
+
+        std::ofstream desc(dir / "descriptor.txt");
+        if (!desc) {
+            std::cerr << "Error: failed to open descriptor file.\n";
+            return;
+        }
+
+        desc << net->layers.size() << "\n";
+        for (int size : net->layers) desc << size << "\n";
+
+        desc << net->learningRate << "\n";
+
+        for (size_t i = 0; i < net->weights.size(); i++) {
+            const FactorizedLayer& layer = net->weights[i];
+            std::string base = "weights_" + std::to_string(i);
+            std::string bFile = "biases_" + std::to_string(i) + ".csv";
+
+            fs::remove(dir / (base + ".csv"));
+            fs::remove(dir / (base + "_a.csv"));
+            fs::remove(dir / (base + "_b.csv"));
+
+            if (layer.is_factorized()) {
+                filer.save_tensor(layer.A.get(), (dir / (base + "_a.csv")).string());
+                filer.save_tensor(layer.B.get(), (dir / (base + "_b.csv")).string());
+            } else {
+                filer.save_tensor(layer.W.get(), (dir / (base + ".csv")).string());
+            }
+            filer.save_tensor(layer.bias.get(), (dir / bFile).string());
+        }
+
+        std::cout << "Factorized network saved successfully in: " << dir << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Save error: " << e.what() << "\n";
+    }
+}
+
+FactorizedNetwork* load_factorized(const std::string& dir_name) {
+    namespace fs = std::filesystem;
+    fs::path dir = dir_name;
+    Filer filer;
+    if (!fs::exists(dir)) {
+        std::cerr << "Directory doesn’t exist.\n";
+        return nullptr;
+    }
+
+    try {
+        std::ifstream desc(dir / "descriptor.txt");
+        if (!desc) {
+            std::cerr << "Descriptor missing.\n";
+            return nullptr;
+        }
+
+        int L = 0;
+        desc >> L;
+        if (!desc || L < 2) {
+            std::cerr << "Descriptor has no valid layer count.\n";
+            return nullptr;
+        }
+
+        // owned here until it is complete, so a throw below cannot leak it
+        auto net = std::make_unique<FactorizedNetwork>();
+        net->layers.resize(L);
+        for (int i = 0; i < L; i++) desc >> net->layers[i];
+        desc >> net->learningRate;
+        if (!desc ||
+            std::any_of(net->layers.begin(), net->layers.end(), [](int n) { return n <= 0; })) {
+            std::cerr << "Descriptor has invalid layer sizes.\n";
+            return nullptr;
+        }
+
+        for (int i = 0; i < L - 1; i++) {
+            std::string base = "weights_" + std::to_string(i);
+            std::string bFile = "biases_" + std::to_string(i) + ".csv";
+            int out = net->layers[i + 1];
+            int in = net->layers[i];
+
+            FactorizedLayer layer;
+            bool ok;
+            if (fs::exists(dir / (base + "_a.csv"))) {
+                layer.A = filer.load_tensor((dir / (base + "_a.csv")).string());
+                layer.B = filer.load_tensor((dir / (base + "_b.csv")).string());
+                ok = layer.A && layer.B && layer.A->rows == out && layer.B->cols == in &&
+                     layer.A->cols == layer.B->rows;
+            } else {
+                layer.W = filer.load_tensor((dir / (base + ".csv")).string());
+                ok = layer.W && layer.W->rows == out && layer.W->cols == in;
+            }
+            layer.bias = filer.load_tensor((dir / bFile).string());
+            ok = ok && layer.bias && layer.bias->rows == out && layer.bias->cols == 1;
+
+            if (!ok) {
+                std::cerr << "Failed loading tensors of shape " << out << "x" << in
+                          << " for layer " << i << "\n";
+                return nullptr;
+            }
+            net->weights.push_back(std::move(layer));
+        }
+
+        std::cout << "Loaded factorized network from: " << dir_name << "\n";
+        return net.release();
+    } catch (const std::exception& e) {
+        std::cerr << "Load error: " << e.what() << "\n";
+        return nullptr;
+    }
+}
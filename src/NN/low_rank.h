@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "neural_network.h"
+
+// Truncated SVD of trained weight matrices.
+// W (m x n) is approximated by A (m x k) * B (k x n), so a layer costs k * (m + n)
+// multiply-adds per sample instead of m * n.
+struct LayerSpectrum {
+    std::vector<double> sigma;  // singular values, descending
+    std::vector<double> basis;  // eigenvectors of the smaller Gram matrix, column-major
+    int dim = 0;                // size of the smaller side
+    bool left = true;           // basis spans the columns of W (m <= n)
+};
+
+LayerSpectrum Tspectrum(const Tensor& W);
+int rank_for_energy(const LayerSpectrum& s, float energy);
+float spectrum_energy(const LayerSpectrum& s, int rank);
+void Tfactorize(const Tensor& W, const LayerSpectrum& s, int rank, std::unique_ptr<Tensor>& A,
+                std::unique_ptr<Tensor>& B);
+
+// a factorized layer only pays off below this rank
+inline int break_even_rank(int m, int n) { return (int)((long)m * n / (m + n)); }
+
+// Layers are either dense (W) or factorized (A, B) and run as two smaller GEMMs.
+struct FactorizedLayer {
+    std::unique_ptr<Tensor> W;
+    std::unique_ptr<Tensor> A;
+    std::unique_ptr<Tensor> B;
+    std::unique_ptr<Tensor> bias;
+
+    inline bool is_factorized() const { return A != nullptr; }
+    inline int rank() const { return A ? A->cols : 0; }
+    long flops() const;
+};
+
+struct FactorizedNetwork {
+    std::vector<int> layers;
+    std::vector<FactorizedLayer> weights;
+    float learningRate;
+
+    long flops() const;
+};
+
+// ranks[i] <= 0 or >= break-even keeps layer i dense; spectra and ranks need one entry per
+// layer (std::runtime_error otherwise)
+FactorizedNetwork* Factorize(const NeuralNetwork* net, const std::vector<LayerSpectrum>& spectra,
+                             const std::vector<int>& ranks);
+std::unique_ptr<Tensor> predict(FactorizedNetwork* net, Tensor* input);
+float evaluate_accuracy(FactorizedNetwork* net, std::vector<Filer::Img>& dataset, int n);
+
+void save_factorized(const FactorizedNetwork* net, const std::string& dir_name);
+FactorizedNetwork* load_factorized(const std::string& dir_name);
@@ -1,9 +1,15 @@
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <numeric>
 #include <string>
 #include <vector>
 
+#include "../Data/augment.h"
+#include "../Data/stream_dataset.h"
+#include "../Trace/trace.h"
 #include "neural_network.h"
+#include "pruning.h"
 /*
 Tmatmul
 Tadd
@@ -43,36 +49,40 @@ std::unique_ptr<Tensor> TaddBias(const Tensor& mat, const Tensor& bias) {
     return out;
 }
 
-// Efficient batch input stacking: avoid creating a temporary flattened tensor per sample.
-std::unique_ptr<Tensor> stack_batch_inputs(const std::vector<Filer::Img>& dataset, int start,
-                                           int batch_size) {
+// gather and normalize the uint8 pixels of order[start .. start + batch_size)
+std::unique_ptr<Tensor> stack_batch_inputs(const Dataset& dataset, const std::vector<int>& order,
+                                           int start, int batch_size) {
+    TRACE_SCOPE("stack inputs");
     int cols = batch_size;
-    int rows = dataset[0].img_data->rows * dataset[0].img_data->cols;  // 784
+    int rows = dataset.pixels();
 
     auto X = std::make_unique<Tensor>(rows, cols);
 
     for (int b = 0; b < batch_size; b++) {
-        const Tensor& img = *dataset[start + b].img_data;  // avoid Tflatten allocation
-        // copy into column b
-        for (int i = 0; i < rows; i++) X->h_data[i * cols + b] = img.h_data[i];
+        const uint8_t* px = dataset.image(order[start + b]);
+        for (int i = 0; i < rows; i++) X->h_data[i * cols + b] = px[i] / 255.0f;
     }
     return X;
 }
 
-// Efficient batch label stacking: create one-hot labels directly.
-std::unique_ptr<Tensor> stack_batch_labels(const std::vector<Filer::Img>& dataset, int start,
-                                           int batch_size) {
+std::unique_ptr<Tensor> stack_batch_labels(const Dataset& dataset, const std::vector<int>& order,
+                                           int start, int batch_size) {
     int cols = batch_size;
     auto Y = std::make_unique<Tensor>(10, cols);
 
     for (int b = 0; b < batch_size; b++) {
-        int lbl = dataset[start + b].label;
+        int lbl = dataset.label(order[start + b]);
         for (int i = 0; i < 10; i++) Y->h_data[i * cols + b] = (i == lbl) ? 1.0f : 0.0f;
     }
 
     return Y;
 }
 
+void TrainState::reset_order(int dataset_size) {
+    order.resize(dataset_size);
+    std::iota(order.begin(), order.end(), 0);
+}
+
 void Train(NeuralNetwork* net, Tensor* X, Tensor* Y) {
     ForwardCache cache = forward_pass_batch(net, X);
 
@@ -88,6 +98,7 @@ void Train(NeuralNetwork* net, Tensor* X, Tensor* Y) {
 }
 
 ForwardCache forward_pass_batch(NeuralNetwork* net, Tensor* X) {
+    TRACE_SCOPE("forward");
     int L = net->layers.size() - 1;
     ForwardCache cache;
 
@@ -95,7 +106,11 @@ ForwardCache forward_pass_batch(NeuralNetwork* net, Tensor* X) {
     Tensor* a = cache.activations.back().get();
 
     for (int i = 0; i < L; i++) {
-        auto z = TaddBias(*Tmatmul(*net->weights[i], *a), *net->biases[i]);
+        std::unique_ptr<Tensor> z;
+        {
+            TRACE_SCOPE_ARG("forward gemm", "layer", i);
+            z = TaddBias(*Tmatmul(*net->weights[i], *a), *net->biases[i]);
+        }
         cache.zvals.push_back(Tcopy(*z));
 
         if (i == L - 1) {
@@ -113,6 +128,7 @@ ForwardCache forward_pass_batch(NeuralNetwork* net, Tensor* X) {
 }
 
 BackwardCache backward_pass_batch(NeuralNetwork* net, const ForwardCache& cache, Tensor* Y) {
+    TRACE_SCOPE("backward");
     int L = net->layers.size() - 1;
     BackwardCache grads;
 
@@ -127,21 +143,31 @@ BackwardCache backward_pass_batch(NeuralNetwork* net, const ForwardCache& cache,
     // OUTPUT LAYER
     dZ[L - 1] = Tsub(*cache.activations[L], *Y);
 
-    auto a_prev_T = Ttranspose(*cache.activations[L - 1]);
-    grads.dW[L - 1] = TmulScalar(*Tmatmul(*dZ[L - 1], *a_prev_T), scale);
+    {
+        TRACE_SCOPE_ARG("dW gemm", "layer", L - 1);
+        auto a_prev_T = Ttranspose(*cache.activations[L - 1]);
+        grads.dW[L - 1] = TmulScalar(*Tmatmul(*dZ[L - 1], *a_prev_T), scale);
+    }
     grads.dB[L - 1] = TmulScalar(*TsumCols(*dZ[L - 1]), scale);  // sum over batch for bias update
 
     // HIDDEN LAYERS
     for (int i = L - 2; i >= 0; i--) {
-        auto wT = Ttranspose(*net->weights[i + 1]);
-        auto tmp = Tmatmul(*wT, *dZ[i + 1]);
+        std::unique_ptr<Tensor> tmp;
+        {
+            TRACE_SCOPE_ARG("dA gemm", "layer", i + 1);
+            auto wT = Ttranspose(*net->weights[i + 1]);
+            tmp = Tmatmul(*wT, *dZ[i + 1]);
+        }
 
         auto actPrime = Tcopy(*cache.zvals[i]);  // derivative uses z (we use ReLU')
         TReluPrime(*actPrime);
         dZ[i] = Tmul(*tmp, *actPrime);
 
-        auto aT = Ttranspose(*cache.activations[i]);
-        grads.dW[i] = TmulScalar(*Tmatmul(*dZ[i], *aT), scale);
+        {
+            TRACE_SCOPE_ARG("dW gemm", "layer", i);
+            auto aT = Ttranspose(*cache.activations[i]);
+            grads.dW[i] = TmulScalar(*Tmatmul(*dZ[i], *aT), scale);
+        }
         grads.dB[i] = TmulScalar(*TsumCols(*dZ[i]), scale);
     }
 
@@ -149,6 +175,7 @@ BackwardCache backward_pass_batch(NeuralNetwork* net, const ForwardCache& cache,
 }
 
 void update_params(NeuralNetwork* net, const BackwardCache& grads) {
+    TRACE_SCOPE("update");
     int L = net->layers.size() - 1;
 
     for (int i = 0; i < L; i++) {
@@ -158,28 +185,81 @@ void update_params(NeuralNetwork* net, const BackwardCache& grads) {
         net->weights[i] = Tsub(*net->weights[i], *scaled_dW);
         net->biases[i] = Tsub(*net->biases[i], *scaled_dB);
     }
-    static bool printed = false;
-    if (!printed) {
+    static std::atomic<bool> printed{false};  // sweeps train on several threads
+    if (!printed.exchange(true))
         std::cout << "Sample weight update: " << grads.dW.back()->h_data[0] << std::endl;
-        printed = true;
-    }
 }
 
-void Train_batch_imgs(NeuralNetwork* net, std::vector<Filer::Img>& dataset, int batch_size) {
-    static std::mt19937 rng(std::random_device{}());
-    std::shuffle(dataset.begin(), dataset.end(), rng);
+void Train_batch_imgs(NeuralNetwork* net, const Dataset& dataset, int batch_size,
+                      TrainState& state, Pruner* pruner) {
+    TRACE_SCOPE_ARG("epoch", "epoch", state.epoch);
+    int total = dataset.size();
+    if ((int)state.order.size() != total) state.reset_order(total);
+    std::shuffle(state.order.begin(), state.order.end(), state.rng);
+
+    for (int start = 0; start < total; start += batch_size) {
+        int bs = std::min(batch_size, total - start);
+
+        auto X = stack_batch_inputs(dataset, state.order, start, bs);
+        auto Y = stack_batch_labels(dataset, state.order, start, bs);
+
+        auto cache = forward_pass_batch(net, X.get());
+        auto grads = backward_pass_batch(net, cache, Y.get());
+        update_params(net, grads);
+        state.step++;
+
+        if (pruner) pruner->step(net);
+    }
+}
 
+void Train_batch_imgs(NeuralNetwork* net, const Dataset& dataset, int batch_size,
+                      TrainState& state, Augmenter& augmenter, Pruner* pruner) {
     int total = dataset.size();
+    if ((int)state.order.size() != total) state.reset_order(total);
+    std::shuffle(state.order.begin(), state.order.end(), state.rng);
+
+    // the step count at the start of the epoch gives every epoch its own transforms
+    uint64_t round = state.step;
+    auto next = augmenter.submit(dataset, state.order, 0, std::min(batch_size, total), round);
 
     for (int start = 0; start < total; start += batch_size) {
         int bs = std::min(batch_size, total - start);
 
-        auto X = stack_batch_inputs(dataset, start, bs);
-        auto Y = stack_batch_labels(dataset, start, bs);
+        auto X = augmenter.collect(next);
+        int following = start + bs;
+        if (following < total) {
+            next = augmenter.submit(dataset, state.order, following,
+                                    std::min(batch_size, total - following), round);
+        }
+        auto Y = stack_batch_labels(dataset, state.order, start, bs);
 
         auto cache = forward_pass_batch(net, X.get());
         auto grads = backward_pass_batch(net, cache, Y.get());
         update_params(net, grads);
+        state.step++;
+
+        if (pruner) pruner->step(net);
+    }
+}
+
+void Train_batch_imgs(NeuralNetwork* net, StreamDataset& stream, int batch_size,
+                      TrainState& state, Pruner* pruner) {
+    stream.start_epoch(state.rng());
+
+    Dataset batch(28, 28);
+    std::vector<int> order(batch_size);
+    std::iota(order.begin(), order.end(), 0);
+
+    while (stream.next_batch(batch_size, batch)) {
+        auto X = stack_batch_inputs(batch, order, 0, batch.size());
+        auto Y = stack_batch_labels(batch, order, 0, batch.size());
+
+        auto cache = forward_pass_batch(net, X.get());
+        auto grads = backward_pass_batch(net, cache, Y.get());
+        update_params(net, grads);
+        state.step++;
+
+        if (pruner) pruner->step(net);
     }
 }
 
@@ -278,7 +358,8 @@ std::unique_ptr<Tensor> predict(NeuralNetwork* net, Tensor* input) {
     return out;
 }
 
-void save(const NeuralNetwork* net, const std::string& dir_name) {
+bool save(const NeuralNetwork* net, const std::string& dir_name, bool verbose) {
+    TRACE_SCOPE("save");
     namespace fs = std::filesystem;
     fs::path dir = dir_name;
 
@@ -290,7 +371,7 @@ void save(const NeuralNetwork* net, const std::string& dir_name) {
         std::ofstream desc(dir / "descriptor.txt");
         if (!desc) {
             std::cerr << "Error: failed to open descriptor file.\n";
-            return;
+            return false;
         }
 
         desc << net->layers.size() << "\n";
@@ -307,13 +388,16 @@ void save(const NeuralNetwork* net, const std::string& dir_name) {
             filer.save_tensor(net->biases[i].get(), (dir / bFile).string());
         }
 
-        std::cout << "Network saved successfully in: " << dir << "\n";
+        if (verbose) std::cout << "Network saved successfully in: " << dir << "\n";
+        return true;
     } catch (const std::exception& e) {
         std::cerr << "Save error: " << e.what() << "\n";
+        return false;
     }
 }
 
 NeuralNetwork* load(const std::string& dir_name) {
+    TRACE_SCOPE("load");
     namespace fs = std::filesystem;
     fs::path dir = dir_name;
     Filer filer;
@@ -329,14 +413,22 @@ NeuralNetwork* load(const std::string& dir_name) {
             return nullptr;
         }
 
-        int L;
+        int L = 0;
         desc >> L;
+        if (!desc || L < 2) {
+            std::cerr << "Descriptor has no valid layer count.\n";
+            return nullptr;
+        }
 
         std::vector<int> layers(L);
         for (int i = 0; i < L; i++) desc >> layers[i];
 
         float lr;
         desc >> lr;
+        if (!desc || std::any_of(layers.begin(), layers.end(), [](int n) { return n <= 0; })) {
+            std::cerr << "Descriptor has invalid layer sizes.\n";
+            return nullptr;
+        }
 
         // Create network object
         auto* net = new NeuralNetwork(layers, lr);
@@ -359,6 +451,17 @@ NeuralNetwork* load(const std::string& dir_name) {
                 return nullptr;
             }
 
+            // the CSVs carry their own shape, it has to agree with the descriptor
+            if (w_raw->rows != layers[i + 1] || w_raw->cols != layers[i] ||
+                b_raw->rows != layers[i + 1] || b_raw->cols != 1) {
+                std::cerr << "Layer " << i << " expects weights " << layers[i + 1] << "x"
+                          << layers[i] << " and biases " << layers[i + 1] << "x1, got "
+                          << w_raw->rows << "x" << w_raw->cols << " and " << b_raw->rows << "x"
+                          << b_raw->cols << "\n";
+                delete net;
+                return nullptr;
+            }
+
             // Replace unique_ptr contents
 
             net->weights[i] = std::move(w_raw);
@@ -1,7 +1,9 @@
 
 #pragma once
+#include <random>
 #include <vector>
 
+#include "../Data/dataset.h"
 #include "../Filer.h"
 #include "../Tensor/tensor.h"
 
@@ -31,6 +33,34 @@ struct NeuralNetwork {
             biases.push_back(std::move(b));
         }
     }
+
+    NeuralNetwork(const NeuralNetwork& other)
+        : layers(other.layers), learningRate(other.learningRate) {
+        for (size_t i = 0; i < other.weights.size(); i++) {
+            weights.push_back(Tcopy(*other.weights[i]));
+            biases.push_back(Tcopy(*other.biases[i]));
+        }
+    }
+};
+
+class Pruner;
+class StreamDataset;
+class Augmenter;
+
+// Everything besides the parameters that decides how training continues; saved in binary
+// checkpoints so a stopped run can resume exactly where it left off.
+struct TrainState {
+    int epoch = 0;  // completed epochs
+    long step = 0;  // optimizer steps taken
+    float best_val = 0.0f;
+
+    std::mt19937 rng;        // drives the per-epoch shuffle
+    std::vector<int> order;  // current permutation of the training set
+
+    TrainState() : rng(std::random_device{}()) {}
+    explicit TrainState(int dataset_size) : TrainState() { reset_order(dataset_size); }
+
+    void reset_order(int dataset_size);
 };
 
 struct ForwardCache {
@@ -45,25 +75,51 @@ struct BackwardCache {
 
 NeuralNetwork* Create(int input, int hidden, int output, float lr);
 void Train_gpu(NeuralNetwork* net, Tensor* X, Tensor* Y);
-void Train_batch_imgs(NeuralNetwork* net, std::vector<Filer::Img>& dataset, int batch_size);
+// one epoch in the order state.order, reshuffled from state.rng; the dataset is not reordered
+void Train_batch_imgs(NeuralNetwork* net, const Dataset& dataset, int batch_size,
+                      TrainState& state, Pruner* pruner = nullptr);
+// inputs come from the augmenter, which prepares the next batch while this one trains
+void Train_batch_imgs(NeuralNetwork* net, const Dataset& dataset, int batch_size,
+                      TrainState& state, Augmenter& augmenter, Pruner* pruner = nullptr);
+// one pass over a streamed corpus; the shard order and shuffle buffer are seeded from state.rng
+void Train_batch_imgs(NeuralNetwork* net, StreamDataset& stream, int batch_size,
+                      TrainState& state, Pruner* pruner = nullptr);
 
 std::unique_ptr<Tensor> predict_img(NeuralNetwork* net, Filer::Img& img);
 float evaluate_accuracy(NeuralNetwork* net, std::vector<Filer::Img>& dataset, int n);
 std::unique_ptr<Tensor> predict(NeuralNetwork* net, Tensor* input);
 
 std::unique_ptr<Tensor> TaddBias(const Tensor& mat, const Tensor& bias);
-std::unique_ptr<Tensor> stack_batch_inputs(const std::vector<Filer::Img>& dataset, int start,
-                                           int batch_size);
-
-std::unique_ptr<Tensor> stack_batch_labels(const std::vector<Filer::Img>& dataset, int start,
-                                           int batch_size);
+// gather the samples order[start .. start + batch_size), normalized to [0, 1]
+std::unique_ptr<Tensor> stack_batch_inputs(const Dataset& dataset, const std::vector<int>& order,
+                                           int start, int batch_size);
+std::unique_ptr<Tensor> stack_batch_labels(const Dataset& dataset, const std::vector<int>& order,
+                                           int start, int batch_size);
 ForwardCache forward_pass_batch(NeuralNetwork* net, Tensor* X);
 BackwardCache backward_pass_batch(NeuralNetwork* net, const ForwardCache& cache, Tensor* Y);
 void update_params(NeuralNetwork* net, const BackwardCache& grads);
 float cross_entropy_batch(const Tensor& predictions, const Tensor& targets);
 float cross_entropy_loss(const Tensor& prediction, const Tensor& target);
-void save(const NeuralNetwork* net, const std::string& filename);
+bool save(const NeuralNetwork* net, const std::string& filename, bool verbose = true);
 NeuralNetwork* load(const std::string& filename);
 void print(const NeuralNetwork* net);
 void Train(NeuralNetwork* net, Tensor* X, Tensor* Y);
 void print_col(const Tensor& T, int col, const std::string& name);
+
+// accuracy on the first n samples, for any network type with a predict(Net*, Tensor*) overload
+template <typename Net>
+float evaluate_accuracy(Net* net, const Dataset& dataset, int n) {
+    n = std::min(n, dataset.size());
+    auto input = std::make_unique<Tensor>(dataset.pixels(), 1);
+    int correct = 0;
+
+    for (int i = 0; i < n; i++) {
+        const uint8_t* px = dataset.image(i);
+        for (int k = 0; k < dataset.pixels(); k++) input->h_data[k] = px[k] / 255.0f;
+
+        auto prediction = predict(net, input.get());
+        if (TArgmax(*prediction) == dataset.label(i)) correct++;
+    }
+
+    return (float)correct / n;
+}
@@ -0,0 +1,324 @@
+#include "pruning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+Pruner::Pruner(const NeuralNetwork* net, const PruneSchedule& schedule) : m_schedule(schedule) {
+    if (schedule.target_sparsity < 0.0f || schedule.target_sparsity >= 1.0f)
+        throw std::runtime_error("target sparsity must be in [0, 1)");
+    if (schedule.end_step < schedule.begin_step || schedule.frequency <= 0)
+        throw std::runtime_error("invalid prune schedule");
+
+    for (const auto& w : net->weights) m_masks.emplace_back(w->size(), 1);
+}
+
+float Pruner::target_sparsity_at(long step) const {
+    if (step <= m_schedule.begin_step) return 0.0f;
+    if (step >= m_schedule.end_step) return m_schedule.target_sparsity;
+
+    float t = (float)(step - m_schedule.begin_step) / (m_schedule.end_step - m_schedule.begin_step);
+    float r = 1.0f - t;
+    return m_schedule.target_sparsity * (1.0f - r * r * r);
+}
+
+void Pruner::step(NeuralNetwork* net) {
+    m_step++;
+
+    bool due = (m_step - m_schedule.begin_step) % m_schedule.frequency == 0 ||
+               m_step == m_schedule.end_step;
+    if (due) {
+        float s = target_sparsity_at(m_step);
+        if (s > m_current) update_masks(net, s);
+    }
+
+    // pruned weights received a gradient in update_params, zero them again
+    if (m_current > 0.0f) apply_masks(net);
+}
+
+void Pruner::update_masks(NeuralNetwork* net, float sparsity) {
+    for (size_t l = 0; l < m_masks.size(); l++) {
+        const Tensor& w = *net->weights[l];
+        std::vector<uint8_t>& mask = m_masks[l];
+
+        int n = w.size();
+        int k = (int)(sparsity * n);
+        if (k <= 0) continue;
+
+        // already pruned weights rank below everything so masks only ever shrink
+        std::vector<float> mag(n);
+        for (int i = 0; i < n; i++) mag[i] = mask[i] ? std::fabs(w.h_data[i]) : -1.0f;
+
+        std::vector<float> order(mag);
+        std::nth_element(order.begin(), order.begin() + (k - 1), order.end());
+        float thr = order[k - 1];
+
+        int pruned = 0;
+        for (int i = 0; i < n; i++) {
+            if (mag[i] < thr) {
+                mask[i] = 0;
+                pruned++;
+            }
+        }
+        for (int i = 0; i < n && pruned < k; i++) {
+            if (mag[i] == thr) {
+                mask[i] = 0;
+                pruned++;
+            }
+        }
+    }
+    m_current = sparsity;
+}
+
+void Pruner::apply_masks(NeuralNetwork* net) const {
+    for (size_t l = 0; l < m_masks.size(); l++) {
+        float* w = net->weights[l]->h_data;
+        const uint8_t* mask = m_masks[l].data();
+        int n = net->weights[l]->size();
+
+        for (int i = 0; i < n; i++)
+            if (!mask[i]) w[i] = 0.0f;
+    }
+}
+
+// layout: i64 step | f32 current sparsity | masks back to back, one byte per weight
+std::vector<char> Pruner::serialize() const {
+    std::vector<char> data(sizeof(int64_t) + sizeof(float));
+    int64_t step = m_step;
+    std::memcpy(data.data(), &step, sizeof(step));
+    std::memcpy(data.data() + sizeof(step), &m_current, sizeof(m_current));
+
+    for (const auto& mask : m_masks) data.insert(data.end(), mask.begin(), mask.end());
+    return data;
+}
+
+bool Pruner::deserialize(const std::vector<char>& data) {
+    size_t header = sizeof(int64_t) + sizeof(float);
+    size_t total = header;
+    for (const auto& mask : m_masks) total += mask.size();
+    if (data.size() != total) return false;
+
+    int64_t step;
+    std::memcpy(&step, data.data(), sizeof(step));
+    std::memcpy(&m_current, data.data() + sizeof(step), sizeof(m_current));
+    m_step = step;
+
+    const char* p = data.data() + header;
+    for (auto& mask : m_masks) {
+        std::memcpy(mask.data(), p, mask.size());
+        p += mask.size();
+    }
+    return true;
+}
+
+float measure_sparsity(const NeuralNetwork* net) {
+    long zeros = 0;
+    long total = 0;
+
+    for (const auto& w : net->weights) {
+        for (int i = 0; i < w->size(); i++)
+            if (w->h_data[i] == 0.0f) zeros++;
+        total += w->size();
+    }
+    return total ? (float)zeros / total : 0.0f;
+}
+
+// ---------------------------------------------------------------
+// Sparse inference
+// ---------------------------------------------------------------
+
+// Time both kernels on a single-sample input (the predict() shape) and keep the faster one.
+static void choose_kernel(SparseLayer& layer) {
+    const SparseTensor& s = *layer.sparse;
+
+    // CSR never wins above ~50% density: it moves twice the bytes per weight
+    if (s.density() > 0.5f) {
+        layer.dense = TtoDense(s);
+        return;
+    }
+
+    auto dense = TtoDense(s);
+    Tensor x(s.cols, 1);
+    TRandomize(x, s.cols);
+
+    auto time_min = [](auto&& fn) {
+        double best = 1e30;
+        for (int rep = 0; rep < 5; rep++) {
+            auto t0 = std::chrono::steady_clock::now();
+            fn();
+            auto t1 = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+        }
+        return best;
+    };
+
+    double t_dense = time_min([&] { Tmatmul(*dense, x); });
+    double t_sparse = time_min([&] { TspMatmul(s, x); });
+
+    if (t_dense < t_sparse) layer.dense = std::move(dense);
+}
+
+size_t SparseNetwork::bytes() const {
+    size_t total = 0;
+    for (const auto& l : weights) {
+        total += l.is_sparse() ? l.sparse->bytes() : l.dense->size() * sizeof(float);
+        total += l.bias->size() * sizeof(float);
+    }
+    return total;
+}
+
+SparseNetwork* Sparsify(const NeuralNetwork* net) {
+    auto* sn = new SparseNetwork();
+    sn->layers = net->layers;
+    sn->learningRate = net->learningRate;
+
+    for (size_t i = 0; i < net->weights.size(); i++) {
+        SparseLayer layer;
+        layer.sparse = TtoSparse(*net->weights[i]);
+        layer.bias = Tcopy(*net->biases[i]);
+        choose_kernel(layer);
+        sn->weights.push_back(std::move(layer));
+    }
+    return sn;
+}
+
+std::unique_ptr<Tensor> predict(SparseNetwork* net, Tensor* input) {
+    Tensor* a = input;
+    int L = net->layers.size() - 1;
+
+    std::unique_ptr<Tensor> out;
+
+    for (int i = 0; i < L; i++) {
+        const SparseLayer& layer = net->weights[i];
+        auto z = layer.is_sparse() ? TspMatmul(*layer.sparse, *a) : Tmatmul(*layer.dense, *a);
+        auto z2 = TaddBias(*z, *layer.bias);
+
+        if (i < L - 1) {
+            TRelu(*z2);
+        } else {
+            TSoftmaxCols(*z2);
+        }
+        out = std::move(z2);
+        a = out.get();
+    }
+
+    return out;
+}
+
+// Same directory layout as save(); weight matrices that are at most half dense are written
+// as binary CSR (weights_i.csr), the rest as the usual CSV.
+void save_sparse(const SparseNetwork* net, const std::string& dir_name) {
+    namespace fs = std::filesystem;
+    fs::path dir = dir_name;
+
+    Filer filer;
+    try {
+        fs::create_directories(dir);
+
+        std::ofstream desc(dir / "descriptor.txt");
+        if (!desc) {
+            std::cerr << "Error: failed to open descriptor file.\n";
+            return;
+        }
+
+        desc << net->layers.size() << "\n";
+        for (int size : net->layers) desc << size << "\n";
+
+        desc << net->learningRate << "\n";
+
+        for (size_t i = 0; i < net->weights.size(); i++) {
+            const SparseLayer& layer = net->weights[i];
+            std::string base = "weights_" + std::to_string(i);
+            std::string bFile = "biases_" + std::to_string(i) + ".csv";
+
+            fs::remove(dir / (base + ".csr"));
+            fs::remove(dir / (base + ".csv"));
+
+            if (layer.sparse->density() <= 0.5f) {
+                filer.save_sparse_tensor(layer.sparse.get(), (dir / (base + ".csr")).string());
+            } else {
+                auto dense = TtoDense(*layer.sparse);
+                filer.save_tensor(dense.get(), (dir / (base + ".csv")).string());
+            }
+            filer.save_tensor(layer.bias.get(), (dir / bFile).string());
+        }
+
+        std::cout << "Sparse network saved successfully in: " << dir << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Save error: " << e.what() << "\n";
+    }
+}
+
+SparseNetwork* load_sparse(const std::string& dir_name) {
+    namespace fs = std::filesystem;
+    fs::path dir = dir_name;
+    Filer filer;
+    if (!fs::exists(dir)) {
+        std::cerr << "Directory doesn’t exist.\n";
+        return nullptr;
+    }
+
+    try {
+        std::ifstream desc(dir / "descriptor.txt");
+        if (!desc) {
+            std::cerr << "Descriptor missing.\n";
+            return nullptr;
+        }
+
+        int L = 0;
+        desc >> L;
+        if (!desc || L < 2) {
+            std::cerr << "Descriptor has no valid layer count.\n";
+            return nullptr;
+        }
+
+        // owned here until it is complete, so a throw below cannot leak it
+        auto net = std::make_unique<SparseNetwork>();
+        net->layers.resize(L);
+        for (int i = 0; i < L; i++) desc >> net->layers[i];
+        desc >> net->learningRate;
+        if (!desc ||
+            std::any_of(net->layers.begin(), net->layers.end(), [](int n) { return n <= 0; })) {
+            std::cerr << "Descriptor has invalid layer sizes.\n";
+            return nullptr;
+        }
+
+        for (int i = 0; i < L - 1; i++) {
+            std::string base = "weights_" + std::to_string(i);
+            std::string bFile = "biases_" + std::to_string(i) + ".csv";
+
+            SparseLayer layer;
+            if (fs::exists(dir / (base + ".csr"))) {
+                layer.sparse = filer.load_sparse_tensor((dir / (base + ".csr")).string());
+            } else {
+                auto dense = filer.load_tensor((dir / (base + ".csv")).string());
+                if (dense) layer.sparse = TtoSparse(*dense);
+            }
+            layer.bias = filer.load_tensor((dir / bFile).string());
+
+            if (!layer.sparse || !layer.bias) {
+                std::cerr << "Failed loading tensor for layer " << i << "\n";
+                return nullptr;
+            }
+            if (layer.sparse->rows != net->layers[i + 1] || layer.sparse->cols != net->layers[i] ||
+                layer.bias->rows != net->layers[i + 1] || layer.bias->cols != 1) {
+                std::cerr << "Layer " << i << " expects weights " << net->layers[i + 1] << "x"
+                          << net->layers[i] << " and biases " << net->layers[i + 1] << "x1, got "
+                          << layer.sparse->rows << "x" << layer.sparse->cols << " and "
+                          << layer.bias->rows << "x" << layer.bias->cols << "\n";
+                return nullptr;
+            }
+
+            choose_kernel(layer);
+            net->weights.push_back(std::move(layer));
+        }
+
+        std::cout << "Loaded sparse network from: " << dir_name << "\n";
+        return net.release();
+    } catch (const std::exception& e) {
+        std::cerr << "Load error: " << e.what() << "\n";
+        return nullptr;
+    }
+}
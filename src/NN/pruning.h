@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Tensor/sparse_tensor.h"
+#include "neural_network.h"
+
+// Iterative magnitude pruning.
+// Sparsity ramps from 0 to target_sparsity between begin_step and end_step following the
+// cubic schedule s(t) = s_f * (1 - (1 - t/n)^3), recomputing the masks every `frequency`
+// optimizer steps. Biases are never pruned.
+struct PruneSchedule {
+    float target_sparsity = 0.9f;
+    long begin_step = 0;
+    long end_step = 1000;
+    int frequency = 50;
+};
+
+class Pruner {
+   public:
+    Pruner(const NeuralNetwork* net, const PruneSchedule& schedule);
+
+    // call once after every update_params(): advances the schedule and re-applies the masks
+    void step(NeuralNetwork* net);
+
+    float target_sparsity_at(long step) const;
+    float current_sparsity() const { return m_current; }
+    long steps() const { return m_step; }
+
+    // schedule position and masks, for resumable checkpoints
+    std::vector<char> serialize() const;
+    bool deserialize(const std::vector<char>& data);
+
+   private:
+    void update_masks(NeuralNetwork* net, float sparsity);
+    void apply_masks(NeuralNetwork* net) const;
+
+    PruneSchedule m_schedule;
+    long m_step = 0;
+    float m_current = 0.0f;
+
+    std::vector<std::vector<uint8_t>> m_masks;  // 1 = keep, one per weight matrix
+};
+
+float measure_sparsity(const NeuralNetwork* net);
+
+// ---------------------------------------------------------------
+// Sparse inference
+// ---------------------------------------------------------------
+
+// Every layer keeps its CSR form for export; `dense` is only filled in when the dense
+// kernel ran faster at build time, so weakly pruned layers stay on Tmatmul.
+struct SparseLayer {
+    std::unique_ptr<SparseTensor> sparse;
+    std::unique_ptr<Tensor> dense;
+    std::unique_ptr<Tensor> bias;
+
+    inline bool is_sparse() const { return dense == nullptr; }
+};
+
+struct SparseNetwork {
+    std::vector<int> layers;
+    std::vector<SparseLayer> weights;
+    float learningRate;
+
+    size_t bytes() const;
+};
+
+SparseNetwork* Sparsify(const NeuralNetwork* net);
+std::unique_ptr<Tensor> predict(SparseNetwork* net, Tensor* input);
+
+void save_sparse(const SparseNetwork* net, const std::string& dir_name);
+SparseNetwork* load_sparse(const std::string& dir_name);
@@ -0,0 +1,356 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "neural_network.h"
+
+namespace {
+
+bool parse_number(const std::string& s, double& out) {
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return end != s.c_str() && *end == '\0' && std::isfinite(out);
+}
+
+bool parse_int(const std::string& s, int& out, int min) {
+    double v;
+    if (!parse_number(s, v) || v != std::floor(v) || v < min) return false;
+    out = (int)v;
+    return true;
+}
+
+bool parse_layers(const std::string& s, std::vector<int>& layers) {
+    std::stringstream ss(s);
+    std::string item;
+    layers.clear();
+    while (std::getline(ss, item, ',')) {
+        int n;
+        if (!parse_int(item, n, 1)) return false;
+        layers.push_back(n);
+    }
+    return layers.size() >= 2;
+}
+
+std::string layers_string(const std::vector<int>& layers) {
+    std::string s;
+    for (size_t i = 0; i < layers.size(); i++) s += (i ? "-" : "") + std::to_string(layers[i]);
+    return s;
+}
+
+// The same He initialization as TRandomize, but drawn from `rng` so that a trial's starting
+// weights follow from the spec's seed instead of the thread's random_device.
+void init_weights(NeuralNetwork& net, std::mt19937& rng) {
+    for (size_t l = 0; l < net.weights.size(); l++) {
+        float bound = sqrtf(6.0f / net.layers[l]);
+        std::uniform_real_distribution<float> dist(-bound, bound);
+        for (Tensor* t : {net.weights[l].get(), net.biases[l].get()})
+            for (int i = 0; i < t->size(); i++) t->h_data[i] = dist(rng);
+    }
+}
+
+// Validation accuracies the trials posted, per epoch, for the median stopping rule.
+class Leaderboard {
+   public:
+    // records `acc` at `epoch` (1-based); returns the median of what other trials posted for
+    // that epoch before, or -1 while fewer than three did
+    float post(int epoch, float acc) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ((int)m_acc.size() < epoch) m_acc.resize(epoch);
+
+        std::vector<float> others = m_acc[epoch - 1];
+        m_acc[epoch - 1].push_back(acc);
+        if (others.size() < 3) return -1.0f;
+
+        auto mid = others.begin() + others.size() / 2;
+        std::nth_element(others.begin(), mid, others.end());
+        return *mid;
+    }
+
+   private:
+    std::mutex m_mutex;
+    std::vector<std::vector<float>> m_acc;
+};
+
+SweepResult run_trial(int id, const SweepConfig& config, const SweepOptions& opts,
+                      const Dataset& train, const Dataset& val, Leaderboard& board) {
+    SweepResult r;
+    r.id = id;
+    r.config = config;
+    r.status = "done";
+
+    NeuralNetwork net(config.layers, config.learning_rate);
+    TrainState state(train.size());
+    state.rng.seed(opts.seed * 1000003 + id);
+    init_weights(net, state.rng);
+
+    auto start = std::chrono::steady_clock::now();
+    int since_best = 0;
+
+    for (int epoch = 1; epoch <= config.epochs; epoch++) {
+        Train_batch_imgs(&net, train, config.batch_size, state);
+        state.epoch = epoch;
+
+        float acc = evaluate_accuracy(&net, val, opts.val_samples);
+        double elapsed =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        r.accuracy.push_back(acc);
+        if (acc > r.best_accuracy) {
+            r.best_accuracy = acc;
+            r.best_epoch = epoch;
+            since_best = 0;
+        } else {
+            since_best++;
+        }
+        if (r.time_to_target < 0.0 && acc >= opts.target_accuracy) r.time_to_target = elapsed;
+
+        float median = board.post(epoch, acc);
+        if (epoch == config.epochs) break;
+        if (epoch > opts.grace_epochs && median >= 0.0f && acc < median) {
+            r.status = "median";
+            break;
+        }
+        if (opts.patience > 0 && since_best >= opts.patience) {
+            r.status = "plateau";
+            break;
+        }
+    }
+
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+}  // namespace
+
+bool load_sweep_spec(const std::string& path, SweepSpec& spec) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Cannot open sweep spec " << path << "\n";
+        return false;
+    }
+
+    std::vector<std::vector<int>> layers;
+    std::vector<float> rates;
+    double rate_lo = 0.0, rate_hi = 0.0;  // log-uniform range, random search only
+    std::vector<int> batches, epochs;
+    int trials = 0;  // > 0: random search
+
+    std::string line;
+    for (int line_no = 1; std::getline(in, line); line_no++) {
+        auto bad = [&](const std::string& why) {
+            std::cerr << path << ":" << line_no << ": " << why << "\n";
+            return false;
+        };
+
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string key, value;
+        if (!(ss >> key)) continue;
+        std::vector<std::string> values;
+        while (ss >> value) values.push_back(value);
+        if (values.empty()) return bad("no value for " + key);
+
+        auto single = [&](int& out, int min) {
+            return values.size() == 1 && parse_int(values[0], out, min);
+        };
+
+        if (key == "search") {
+            if (values[0] == "grid" && values.size() == 1) {
+                trials = 0;
+            } else if (values[0] != "random" || values.size() != 2 ||
+                       !parse_int(values[1], trials, 1)) {
+                return bad("expected 'search grid' or 'search random N'");
+            }
+        } else if (key == "layers") {
+            for (const auto& v : values) {
+                layers.emplace_back();
+                if (!parse_layers(v, layers.back())) return bad("bad layer list " + v);
+            }
+        } else if (key == "learning_rate") {
+            for (const auto& v : values) {
+                size_t colon = v.find(':');
+                double lr;
+                if (colon != std::string::npos) {
+                    if (values.size() != 1 || !parse_number(v.substr(0, colon), rate_lo) ||
+                        !parse_number(v.substr(colon + 1), rate_hi) || rate_lo <= 0.0 ||
+                        rate_hi < rate_lo)
+                        return bad("bad learning rate range " + v);
+                } else if (!parse_number(v, lr) || lr <= 0.0) {
+                    return bad("bad learning rate " + v);
+                } else {
+                    rates.push_back((float)lr);
+                }
+            }
+        } else if (key == "batch_size" || key == "epochs") {
+            auto& list = key == "epochs" ? epochs : batches;
+            for (const auto& v : values) {
+                int n;
+                if (!parse_int(v, n, 1)) return bad("bad " + key + " " + v);
+                list.push_back(n);
+            }
+        } else if (key == "train_samples") {
+            if (!single(spec.train_samples, 1)) return bad("bad train_samples");
+        } else if (key == "val_samples") {
+            if (!single(spec.options.val_samples, 1)) return bad("bad val_samples");
+        } else if (key == "workers") {
+            if (!single(spec.options.workers, 0)) return bad("bad workers");
+        } else if (key == "grace_epochs") {
+            if (!single(spec.options.grace_epochs, 0)) return bad("bad grace_epochs");
+        } else if (key == "patience") {
+            if (!single(spec.options.patience, 0)) return bad("bad patience");
+        } else if (key == "target_accuracy") {
+            double v;
+            if (values.size() != 1 || !parse_number(values[0], v) || v < 0.0 || v > 1.0)
+                return bad("bad target_accuracy");
+            spec.options.target_accuracy = (float)v;
+        } else if (key == "seed") {
+            int seed;
+            if (!single(seed, 0)) return bad("bad seed");
+            spec.options.seed = seed;
+        } else {
+            return bad("unknown setting " + key);
+        }
+    }
+
+    bool rate_range = rate_hi > 0.0;
+    if (layers.empty() || (rates.empty() && !rate_range)) {
+        std::cerr << path << ": layers and learning_rate are required\n";
+        return false;
+    }
+    if (rate_range && trials == 0) {
+        std::cerr << path << ": a learning_rate range needs 'search random N'\n";
+        return false;
+    }
+    if (batches.empty()) batches.push_back(64);
+    if (epochs.empty()) epochs.push_back(10);
+
+    spec.configs.clear();
+    if (trials == 0) {
+        for (const auto& l : layers)
+            for (float lr : rates)
+                for (int b : batches)
+                    for (int e : epochs) spec.configs.push_back({l, lr, b, e});
+        return true;
+    }
+
+    std::mt19937_64 rng(spec.options.seed);
+    auto pick = [&](const auto& list) { return list[rng() % list.size()]; };
+    for (int t = 0; t < trials; t++) {
+        SweepConfig c;
+        c.layers = pick(layers);
+        if (rate_range) {
+            std::uniform_real_distribution<double> u(std::log(rate_lo), std::log(rate_hi));
+            c.learning_rate = (float)std::exp(u(rng));
+        } else {
+            c.learning_rate = pick(rates);
+        }
+        c.batch_size = pick(batches);
+        c.epochs = pick(epochs);
+        spec.configs.push_back(c);
+    }
+    return true;
+}
+
+std::vector<SweepResult> run_sweep(const std::vector<SweepConfig>& configs,
+                                   const SweepOptions& opts, const Dataset& train,
+                                   const Dataset& val) {
+    std::vector<SweepResult> results(configs.size());
+    Leaderboard board;
+    std::atomic<int> next{0};
+    std::mutex print_mutex;
+
+    int workers = opts.workers > 0 ? opts.workers : (int)std::thread::hardware_concurrency();
+    workers = std::max(1, std::min(workers, (int)configs.size()));
+    std::cout << "Sweeping " << configs.size() << " configurations on " << workers
+              << " workers\n";
+
+    auto worker = [&]() {
+        for (int id; (id = next++) < (int)configs.size();) {
+            SweepResult r = run_trial(id, configs[id], opts, train, val, board);
+
+            std::lock_guard<std::mutex> lock(print_mutex);
+            std::cout << "[" << id + 1 << "/" << configs.size() << "] "
+                      << layers_string(r.config.layers) << " lr " << r.config.learning_rate
+                      << " batch " << r.config.batch_size << ": best " << r.best_accuracy
+                      << " at epoch " << r.best_epoch << " of " << r.accuracy.size() << " ("
+                      << r.status << ", " << r.seconds << " s)" << std::endl;
+            results[id] = std::move(r);
+        }
+    };
+
+    // the trials only read the datasets, which are never modified while they run
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers; w++) threads.emplace_back(worker);
+    for (auto& t : threads) t.join();
+
+    std::stable_sort(results.begin(), results.end(), [](const auto& a, const auto& b) {
+        if (a.best_accuracy != b.best_accuracy) return a.best_accuracy > b.best_accuracy;
+        bool a_hit = a.time_to_target >= 0.0, b_hit = b.time_to_target >= 0.0;
+        if (a_hit != b_hit) return a_hit;
+        if (a_hit && a.time_to_target != b.time_to_target)
+            return a.time_to_target < b.time_to_target;
+        return a.seconds < b.seconds;
+    });
+    return results;
+}
+
+void print_sweep_results(const std::vector<SweepResult>& results, const SweepOptions& opts,
+                         std::ostream& out) {
+    out << "\n"
+        << std::left << std::setw(5) << "rank" << std::setw(5) << "id" << std::setw(20)
+        << "layers" << std::right << std::setw(10) << "lr" << std::setw(7) << "batch"
+        << std::setw(8) << "epochs" << std::setw(9) << "best" << std::setw(7) << "at"
+        << std::setw(12) << ("to " + std::to_string((int)std::lround(100 * opts.target_accuracy)) +
+                             "%")
+        << std::setw(10) << "time s" << "  status\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const SweepResult& r = results[i];
+        std::ostringstream to_target;
+        if (r.time_to_target >= 0.0)
+            to_target << std::fixed << std::setprecision(2) << r.time_to_target;
+        else
+            to_target << "-";
+
+        out << std::left << std::setw(5) << i + 1 << std::setw(5) << r.id << std::setw(20)
+            << layers_string(r.config.layers) << std::right << std::setw(10)
+            << r.config.learning_rate << std::setw(7) << r.config.batch_size << std::setw(8)
+            << (std::to_string(r.accuracy.size()) + "/" + std::to_string(r.config.epochs))
+            << std::fixed << std::setprecision(4) << std::setw(9) << r.best_accuracy
+            << std::setw(7) << r.best_epoch << std::setw(12) << to_target.str()
+            << std::setprecision(2) << std::setw(10) << r.seconds << std::defaultfloat << "  "
+            << r.status << "\n";
+    }
+}
+
+bool save_sweep_results(const std::vector<SweepResult>& results, const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write sweep results to " << path << "\n";
+        return false;
+    }
+
+    out << "rank,id,layers,learning_rate,batch_size,epochs,epochs_run,best_accuracy,best_epoch,"
+           "time_to_target,seconds,status,accuracy_per_epoch\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const SweepResult& r = results[i];
+        out << i + 1 << "," << r.id << "," << layers_string(r.config.layers) << ","
+            << r.config.learning_rate << "," << r.config.batch_size << "," << r.config.epochs
+            << "," << r.accuracy.size() << "," << r.best_accuracy << "," << r.best_epoch << ","
+            << r.time_to_target << "," << r.seconds << "," << r.status << ",";
+        for (size_t e = 0; e < r.accuracy.size(); e++) out << (e ? ";" : "") << r.accuracy[e];
+        out << "\n";
+    }
+    return (bool)out;
+}
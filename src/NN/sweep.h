@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "../Data/dataset.h"
+
+// Hyperparameter sweeps: many small networks trained at once on one shared, read-only
+// dataset.
+//
+// The spec is a text file with one setting per line, '#' starts a comment:
+//
+//   search grid                     # every combination, or "search random N" for N draws
+//   layers 784,128,10 784,256,64,10
+//   learning_rate 0.1 0.03 0.01     # random search also takes a log-uniform range 0.001:0.1
+//   batch_size 32 64
+//   epochs 15
+//   train_samples 5000              # rows of the training / validation CSVs to load
+//   val_samples 1000
+//   workers 0                       # concurrent trials, 0 = one per core
+//   grace_epochs 3                  # epochs before the median rule may stop a trial
+//   patience 4                      # stop after this many epochs without improvement, 0 = off
+//   target_accuracy 0.9             # threshold for time-to-accuracy
+//   seed 1                          # initial weights and shuffle order of every trial
+//
+// Each trial is single-threaded and trials are scheduled over `workers` threads. After every
+// epoch a trial posts its validation accuracy; once past grace_epochs it is stopped if it is
+// below the median that the other trials reached at the same epoch (with at least three of
+// them reported), so weak configurations give their core to the remaining ones early.
+struct SweepConfig {
+    std::vector<int> layers;
+    float learning_rate = 0.01f;
+    int batch_size = 64;
+    int epochs = 10;
+};
+
+struct SweepOptions {
+    int workers = 0;
+    int grace_epochs = 3;
+    int patience = 0;
+    float target_accuracy = 0.9f;
+    int val_samples = 200;  // evaluated after every epoch
+    uint64_t seed = 1;
+};
+
+struct SweepSpec {
+    std::vector<SweepConfig> configs;
+    SweepOptions options;
+    int train_samples = 0;  // 0 = the caller's default
+};
+
+struct SweepResult {
+    int id = 0;  // index in the spec's configs
+    SweepConfig config;
+    std::vector<float> accuracy;  // validation accuracy after each epoch run
+    float best_accuracy = 0.0f;
+    int best_epoch = 0;
+    double seconds = 0.0;          // training and validation time of this trial
+    double time_to_target = -1.0;  // seconds until target_accuracy was first reached, -1 never
+    std::string status;            // "done", "median" or "plateau"
+};
+
+// false (with the reason on stderr) if the file is missing or malformed
+bool load_sweep_spec(const std::string& path, SweepSpec& spec);
+
+// Trains every config on `train`, validating on `val`; results sorted by best accuracy, then
+// time to the target accuracy.
+std::vector<SweepResult> run_sweep(const std::vector<SweepConfig>& configs,
+                                   const SweepOptions& opts, const Dataset& train,
+                                   const Dataset& val);
+
+void print_sweep_results(const std::vector<SweepResult>& results, const SweepOptions& opts,
+                         std::ostream& out);
+bool save_sweep_results(const std::vector<SweepResult>& results, const std::string& path);
@@ -0,0 +1,146 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Predictor.h"
+#include "raylib.h"
+
+// Compatibility helpers (for older raylib)
+static float Vector2Distance(Vector2 v1, Vector2 v2) {
+    float dx = v2.x - v1.x;
+    float dy = v2.y - v1.y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static Vector2 Vector2Lerp(Vector2 v1, Vector2 v2, float t) {
+    Vector2 result;
+    result.x = v1.x + t * (v2.x - v1.x);
+    result.y = v1.y + t * (v2.y - v1.y);
+    return result;
+}
+
+int main(void) {
+    const int screenWidth = 450;
+    const int screenHeight = 450;
+
+    InitWindow(screenWidth, screenHeight, "MNIST Drawer - 28x28 Export");
+
+    RenderTexture2D target = LoadRenderTexture(screenWidth, screenHeight);
+
+    BeginTextureMode(target);
+    ClearBackground(RAYWHITE);
+    EndTextureMode();
+
+    float brushSize = 16.0f;  // good thickness for MNIST digits
+    const float BRUSH_MIN = 8.0f;
+    const float BRUSH_MAX = 40.0f;
+
+    Vector2 previousPos = {-100, -100};
+    bool isDrawing = false;
+
+    bool exportFiles = false;  // E: also write drawing.csv / drawing_28x28.raw
+    int prediction = -1;
+    float confidence = 0.0f;
+
+    SetTargetFPS(120);
+
+    while (!WindowShouldClose()) {
+        Vector2 mousePos = GetMousePosition();
+
+        // Brush size
+        brushSize += GetMouseWheelMove() * 4.0f;
+        if (brushSize < BRUSH_MIN) brushSize = BRUSH_MIN;
+        if (brushSize > BRUSH_MAX) brushSize = BRUSH_MAX;
+
+        // Clear
+        if (IsKeyPressed(KEY_C)) {
+            BeginTextureMode(target);
+            ClearBackground(RAYWHITE);
+            EndTextureMode();
+            previousPos = (Vector2){-100, -100};
+            prediction = -1;
+        }
+
+        // Drawing logic
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            isDrawing = true;
+            previousPos = mousePos;
+        }
+        if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+            isDrawing = false;
+            previousPos = (Vector2){-100, -100};
+        }
+
+        if (isDrawing && mousePos.y > 50) {
+            BeginTextureMode(target);
+
+            float dist = Vector2Distance(previousPos, mousePos);
+            int steps = (int)(dist / 2.0f);
+            if (steps < 1) steps = 1;
+
+            for (int i = 1; i <= steps; i++) {
+                float t = (float)i / steps;
+                Vector2 pos = Vector2Lerp(previousPos, mousePos, t);
+                DrawCircle((int)pos.x, (int)pos.y, brushSize, BLACK);
+            }
+            DrawCircle((int)mousePos.x, (int)mousePos.y, brushSize, BLACK);
+
+            EndTextureMode();
+            previousPos = mousePos;
+        }
+
+        // Export toggle: files are only written when asked for, off the frame loop
+        if (IsKeyPressed(KEY_E)) exportFiles = !exportFiles;
+
+        // PREDICT: canvas pixels -> 28x28 digit -> network, all in memory
+        if (IsKeyPressed(KEY_S)) {
+            Image canvas = LoadImageFromTexture(target.texture);
+            if (canvas.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+                ImageFormat(&canvas, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+            unsigned char digit[DIGIT_PIXELS];
+            float input[DIGIT_PIXELS];
+
+            // render textures are stored bottom-up
+            if (preprocess_canvas((const unsigned char*)canvas.data, canvas.width, canvas.height,
+                                  true, digit, input)) {
+                prediction = predict_pixels(input, &confidence);
+                if (exportFiles) export_drawing(digit);
+            } else {
+                prediction = -1;
+                TraceLog(LOG_INFO, "Nothing drawn");
+            }
+
+            UnloadImage(canvas);
+        }
+        // Draw UI
+        BeginDrawing();
+        ClearBackground(RAYWHITE);
+
+        DrawTextureRec(target.texture, (Rectangle){0, 0, screenWidth, -screenHeight},
+                       (Vector2){0, 0}, WHITE);
+
+        if (mousePos.y > 50) {
+            DrawCircleLines((int)mousePos.x, (int)mousePos.y, brushSize, BLACK);
+        }
+
+        DrawRectangle(0, 0, screenWidth, 50, Fade(LIGHTGRAY, 0.8f));
+        DrawLine(0, 50, screenWidth, 50, GRAY);
+
+        DrawText("MNIST Drawer | LMB: Draw | Wheel: Size | C: Clear | S: Predict", 10, 10, 18,
+                 DARKGRAY);
+        DrawText(TextFormat("Brush: %.0f px | E: Export %s", brushSize, exportFiles ? "on" : "off"),
+                 10, 30, 16, DARKGRAY);
+        if (prediction >= 0) {
+            DrawText(TextFormat("Prediction: %d (%.0f%%)", prediction, confidence * 100.0f), 250,
+                     30, 16, DARKBLUE);
+        }
+
+        EndDrawing();
+    }
+
+    UnloadRenderTexture(target);
+    CloseWindow();
+
+    return 0;
+}
@@ -1,4 +1,12 @@
 #include "./Predictor.h"
+
+#include <array>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
 Filer filer;
 void print(const std::string& file) {
     auto ten = filer.load_single_image(file);
@@ -14,23 +22,130 @@ void print(const std::string& file) {
         std::cout << "\n";
     }
 }
-void predict_on_save(const std::string& pred_in) {
-    const std::string FileDir = "../../nn-models/nnv1_96";
+// The model is opened on the first prediction and then watched, so retraining into the same
+// place swaps in the new weights without restarting (see Infer/model_watcher.h). The
+// single-file binary form is preferred when it exists (build it with convert_model).
+static std::shared_ptr<const InferenceModel> predictor_model() {
+    static std::unique_ptr<ModelWatcher> watcher;
 
-    NeuralNetwork* prednet = load(FileDir);
+    if (!watcher) {
+        const std::string FileDir = "../../nn-models/nnv1_96";
+        std::string path = std::filesystem::exists(FileDir + ".mnm") ? FileDir + ".mnm" : FileDir;
 
-    if (!prednet) {
+        WatchOptions opts;
+        opts.max_batch = 1;
+        opts.max_threads = 1;
+        auto next = std::make_unique<ModelWatcher>(path, opts);
+        if (!next->start()) return nullptr;
+
+        watcher = std::move(next);
+        std::cout << "Neural_network loaded successfully\n";
+    }
+    return watcher->current();
+}
+
+int predict_pixels(const float* input, float* confidence) {
+    // held for the whole call, a reload meanwhile does not pull it away
+    std::shared_ptr<const InferenceModel> model = predictor_model();
+
+    if (!model) {
         std::cerr << "Neural_network failed to load\n";
+        return -1;
     }
 
-    std::cout << "Neural_network loaded successfully\n";
+    std::vector<float> probs(model->output_size());
+    model->run(input, 1, probs.data());
 
+    int best = std::max_element(probs.begin(), probs.end()) - probs.begin();
+    std::cout << "Prediction: " << best << " (" << probs[best] << ")" << std::endl;
+    if (confidence) *confidence = probs[best];
+    return best;
+}
+
+std::vector<int> predictor_layers() {
+    std::shared_ptr<const InferenceModel> model = predictor_model();
+    return model ? model->layers() : std::vector<int>();
+}
+
+bool predict_activations(const float* input, std::vector<std::vector<float>>& layers) {
+    std::shared_ptr<const InferenceModel> model = predictor_model();
+    if (!model) return false;
+
+    model->run_layers(input, layers);
+    return true;
+}
+
+void predict_on_save(const std::string& pred_in) {
     auto input = filer.load_single_image(pred_in);
 
     // print(pred_in);  // or print(*input) if we rewrite print()
 
-    auto img = Tflatten(*input);
-    auto result = predict(prednet, img.get());
+    predict_pixels(input->h_data, nullptr);
+}
+
+// ---------------------------------------------------------------
+// Background export
+// ---------------------------------------------------------------
+
+namespace {
+
+class DrawingExporter {
+   public:
+    ~DrawingExporter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    void submit(const uint8_t* pixels) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::copy(pixels, pixels + DIGIT_PIXELS, m_pending.begin());
+        m_has_pending = true;
+        if (!m_thread.joinable()) m_thread = std::thread(&DrawingExporter::run, this);
+        m_cv.notify_one();
+    }
+
+   private:
+    void run() {
+        std::array<uint8_t, DIGIT_PIXELS> pixels;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [&] { return m_stop || m_has_pending; });
+                if (!m_has_pending) return;
+                pixels = m_pending;
+                m_has_pending = false;
+            }
+            write(pixels.data());
+        }
+    }
+
+    static void write(const uint8_t* pixels) {
+        std::ofstream csv("drawing.csv");
+        csv << "0";  // placeholder label
+        for (int i = 0; i < DIGIT_PIXELS; i++) csv << "," << (int)pixels[i];
+        csv << "\n";
+
+        std::ofstream raw("drawing_28x28.raw", std::ios::binary);
+        raw.write(reinterpret_cast<const char*>(pixels), DIGIT_PIXELS);
+
+        if (!csv || !raw) std::cerr << "Failed to export drawing\n";
+    }
+
+    std::array<uint8_t, DIGIT_PIXELS> m_pending{};
+    bool m_has_pending = false;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+};
+
+}  // namespace
 
-    std::cout << "Prediction: " << TArgmax(*result) << std::endl;
+void export_drawing(const uint8_t* pixels) {
+    static DrawingExporter exporter;
+    exporter.submit(pixels);
 }
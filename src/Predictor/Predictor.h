@@ -1,13 +1,34 @@
 #pragma once
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "../Filer.h"
+#include "../Infer/inference_model.h"
+#include "../Infer/model_file.h"
+#include "../Infer/model_watcher.h"
 #include "../NN/neural_network.h"
 #include "../Tensor/tensor.h"
+#include "preprocess.h"
 extern Filer filer;
 
 void print(const std::string& file);
 void predict_on_save(const std::string& pred_in);
+
+// Runs the network on 784 normalized pixels and prints the result.
+// Returns the predicted class (its probability in `confidence`), -1 if no model could be loaded.
+int predict_pixels(const float* input, float* confidence);
+
+// Layer sizes of the predictor's model, input first; empty if it cannot be loaded.
+std::vector<int> predictor_layers();
+
+// Every layer's activations for 784 normalized pixels (hidden layers after ReLU, softmax
+// last; the input itself is not included). false if no model could be loaded.
+bool predict_activations(const float* input, std::vector<std::vector<float>>& layers);
+
+// Writes drawing.csv and drawing_28x28.raw on a background thread; a newer drawing replaces
+// one that has not been written yet.
+void export_drawing(const uint8_t* pixels);
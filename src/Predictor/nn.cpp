@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "Predictor.h"
+#include "raylib.h"
+
+#define MAX_LAYERS 8
+#define IN_VISIBLE 50
+#define HID_VISIBLE 75
+
+// Most recent digit: the drawer writes it here when export is on (E in DrawWin)
+#define DRAWING_FILE "drawing_28x28.raw"
+
+typedef struct {
+    int width;
+    int height;
+} AppConfig;
+
+AppConfig app;
+
+typedef struct {
+    Vector2 pos;
+    float radius;
+    float activation;  // 0..1, relative to the strongest node of the layer
+} Node;
+
+// Layer sizes come from the model (input first); each visible node stands for `stride`
+// real neurons.
+int layerCount = 0;
+int layerSize[MAX_LAYERS];
+int visible[MAX_LAYERS];
+int stride[MAX_LAYERS];
+Node nodes[MAX_LAYERS][HID_VISIBLE];
+
+// Connections never change, so they are drawn once into this texture
+RenderTexture2D connections;
+
+int prediction = -1;
+
+// Size and nanosecond mtime of the drawing last shown. raylib's GetFileModTime() only has
+// whole seconds, so a second drawing exported within the same second looked unchanged.
+struct FileStamp {
+    off_t size = -1;
+    struct timespec mtime = {0, 0};
+
+    bool operator==(const FileStamp& o) const {
+        return size == o.size && mtime.tv_sec == o.mtime.tv_sec &&
+               mtime.tv_nsec == o.mtime.tv_nsec;
+    }
+};
+FileStamp drawingStamp;
+
+static bool GetFileStamp(const char* path, FileStamp& stamp) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    stamp.size = st.st_size;
+    stamp.mtime = st.st_mtim;
+    return true;
+}
+
+// Compatibility helper (ColorLerp only exists in newer raylib)
+static Color LerpColor(Color a, Color b, float t) {
+    Color c;
+    c.r = (unsigned char)(a.r + t * (b.r - a.r));
+    c.g = (unsigned char)(a.g + t * (b.g - a.g));
+    c.b = (unsigned char)(a.b + t * (b.b - a.b));
+    c.a = 255;
+    return c;
+}
+
+void InitNodes() {
+    float spacing = 4.0f;
+    float radius = (app.height / HID_VISIBLE) * 0.3f;
+    float height = (2.0f * radius + spacing);
+
+    for (int l = 0; l < layerCount; l++) {
+        int cap = (l == 0) ? IN_VISIBLE : HID_VISIBLE;
+        visible[l] = layerSize[l] < cap ? layerSize[l] : cap;
+        stride[l] = layerSize[l] / visible[l];
+
+        // layers spread over 25% .. 85% of the width
+        float x = app.width * (0.25f + 0.60f * l / (layerCount - 1));
+        float column = (app.height - (visible[l] * height)) / 2.0f;
+
+        for (int i = 0; i < visible[l]; i++) {
+            nodes[l][i].radius = radius;
+            nodes[l][i].pos.x = x;
+            nodes[l][i].pos.y = column + i * height;
+            nodes[l][i].activation = 0.0f;
+        }
+    }
+
+    // every second target node, like before: dense enough to read, half the lines
+    connections = LoadRenderTexture(app.width, app.height);
+    BeginTextureMode(connections);
+    ClearBackground(BLANK);
+    for (int l = 0; l + 1 < layerCount; l++) {
+        for (int i = 0; i < visible[l]; i++) {
+            for (int j = 0; j < visible[l + 1]; j += 2) {
+                DrawLineEx(nodes[l][i].pos, nodes[l + 1][j].pos, 1.0f, DARKGRAY);
+            }
+        }
+    }
+    EndTextureMode();
+
+    printf("[InitNodes] radius=%.2f layers=%d", radius, layerCount);
+    for (int l = 0; l < layerCount; l++) printf(" %d(/%d)", layerSize[l], stride[l]);
+    printf("\n");
+}
+
+// Runs the model on the latest exported drawing and maps every layer onto its visible nodes
+// (the strongest neuron of each group, scaled by the layer maximum).
+void UpdateActivations() {
+    FileStamp stamp;
+    if (!GetFileStamp(DRAWING_FILE, stamp) || stamp == drawingStamp) return;
+
+    int bytes = 0;
+    unsigned char* raw = LoadFileData(DRAWING_FILE, &bytes);
+    if (!raw) return;
+    if (bytes != DIGIT_PIXELS) {  // still being written, try again next frame
+        UnloadFileData(raw);
+        return;
+    }
+    drawingStamp = stamp;
+
+    std::vector<std::vector<float>> values(1, std::vector<float>(DIGIT_PIXELS));
+    for (int i = 0; i < DIGIT_PIXELS; i++) values[0][i] = raw[i] / 255.0f;
+    UnloadFileData(raw);
+
+    std::vector<std::vector<float>> hidden;
+    if (!predict_activations(values[0].data(), hidden)) return;
+    values.insert(values.end(), hidden.begin(), hidden.end());
+
+    for (int l = 0; l < layerCount; l++) {
+        const std::vector<float>& a = values[l];
+
+        float layerMax = 1e-6f;
+        for (float v : a) layerMax = v > layerMax ? v : layerMax;
+
+        for (int i = 0; i < visible[l]; i++) {
+            float groupMax = 0.0f;
+            for (int k = i * stride[l]; k < (i + 1) * stride[l]; k++)
+                groupMax = a[k] > groupMax ? a[k] : groupMax;
+            nodes[l][i].activation = groupMax / layerMax;
+        }
+    }
+
+    const std::vector<float>& out = values[layerCount - 1];
+    prediction = (int)(std::max_element(out.begin(), out.end()) - out.begin());
+}
+
+void DrawNodes() {
+    // cached connections (render textures are stored upside down)
+    DrawTextureRec(connections.texture,
+                   (Rectangle){0, 0, (float)app.width, -(float)app.height}, (Vector2){0, 0},
+                   WHITE);
+
+    for (int l = 0; l < layerCount; l++) {
+        Color base = (l == 0) ? GREEN : RED;
+        for (int i = 0; i < visible[l]; i++) {
+            // dim when silent, full colour when the node fires
+            Color c = LerpColor(DARKGRAY, base, nodes[l][i].activation);
+            DrawCircleV(nodes[l][i].pos, nodes[l][i].radius, c);
+        }
+    }
+
+    if (prediction >= 0) {
+        const Node* best = &nodes[layerCount - 1][prediction];
+        DrawText(TextFormat("%d", prediction), (int)(best->pos.x + 3 * best->radius),
+                 (int)(best->pos.y - best->radius), (int)(4 * best->radius), RAYWHITE);
+    }
+    DrawFPS(10, 10);
+}
+
+int main(void) {
+    std::vector<int> sizes = predictor_layers();
+    if (sizes.size() < 2 || sizes.size() > MAX_LAYERS) {
+        fprintf(stderr, "No usable model for the visualizer\n");
+        return 1;
+    }
+    layerCount = (int)sizes.size();
+    for (int l = 0; l < layerCount; l++) layerSize[l] = sizes[l];
+
+    // Init minimal window to force GLFW to load monitors
+    InitWindow(100, 100, "temp");
+
+    int mon = GetCurrentMonitor();
+    app.width = GetMonitorWidth(mon);
+    app.height = GetMonitorHeight(mon);
+
+    printf("Monitor=%d WIDTH=%d HEIGHT=%d\n", mon, app.width, app.height);
+
+    // Resize instead of closing (avoids GLX crash)
+    SetWindowSize(app.width, app.height);
+    SetWindowTitle("Neural Network Visualizer");
+
+    InitNodes();
+    SetTargetFPS(60);
+
+    while (!WindowShouldClose()) {
+        UpdateActivations();
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+        DrawNodes();
+        EndDrawing();
+    }
+
+    UnloadRenderTexture(connections);
+    CloseWindow();
+    return 0;
+}
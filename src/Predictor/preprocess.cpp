@@ -0,0 +1,90 @@
+#include "preprocess.h"
+
+#include <algorithm>
+#include <vector>
+
+// ink above this counts towards the bounding box (the old r + g + b < 600 test)
+static constexpr int INK_THRESHOLD = 55;
+
+bool preprocess_canvas(const uint8_t* rgba, int width, int height, bool bottom_up,
+                       uint8_t* pixels, float* input) {
+    // pass 1: ink = 255 - gray, plus per-row and per-column maxima for the bounding box.
+    // The inner loops are plain element-wise / max reductions, which the compiler vectorizes.
+    std::vector<uint8_t> ink((size_t)width * height);
+    std::vector<uint8_t> row_max(height, 0), col_max(width, 0);
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)(bottom_up ? height - 1 - y : y) * width * 4;
+        uint8_t* dst = ink.data() + (size_t)y * width;
+
+        for (int x = 0; x < width; x++) {
+            int gray = (77 * src[4 * x] + 150 * src[4 * x + 1] + 29 * src[4 * x + 2]) >> 8;
+            dst[x] = (uint8_t)(255 - gray);
+        }
+
+        uint8_t m = 0;
+        for (int x = 0; x < width; x++) {
+            m = std::max(m, dst[x]);
+            col_max[x] = std::max(col_max[x], dst[x]);
+        }
+        row_max[y] = m;
+    }
+
+    auto dark = [](uint8_t v) { return v > INK_THRESHOLD; };
+    int min_y = (int)(std::find_if(row_max.begin(), row_max.end(), dark) - row_max.begin());
+    bool drawn = min_y < height;
+
+    // crop: a square around the ink with 20% padding, clipped to the canvas
+    int x0 = 0, y0 = 0, x1 = width, y1 = height;
+    if (drawn) {
+        int max_y = height - 1 -
+                    (int)(std::find_if(row_max.rbegin(), row_max.rend(), dark) - row_max.rbegin());
+        int min_x = (int)(std::find_if(col_max.begin(), col_max.end(), dark) - col_max.begin());
+        int max_x = width - 1 -
+                    (int)(std::find_if(col_max.rbegin(), col_max.rend(), dark) - col_max.rbegin());
+
+        float bw = max_x - min_x + 1.0f;
+        float bh = max_y - min_y + 1.0f;
+        float size = std::max(bw, bh) * 1.4f;
+
+        x0 = std::max(0, (int)(min_x - (size - bw) / 2.0f));
+        y0 = std::max(0, (int)(min_y - (size - bh) / 2.0f));
+        x1 = std::min(width, (int)(min_x - (size - bw) / 2.0f + size));
+        y1 = std::min(height, (int)(min_y - (size - bh) / 2.0f + size));
+    }
+
+    // pass 2: area average. Rows of one output band are summed first, then the columns.
+    int cw = x1 - x0;
+    int ch = y1 - y0;
+    std::vector<uint32_t> band(cw);
+
+    // contrast 80 as raylib applies it: ((v - 0.5) * 1.8^2 + 0.5), clamped
+    constexpr float CONTRAST = 1.8f * 1.8f;
+
+    for (int oy = 0; oy < DIGIT_SIDE; oy++) {
+        int ylo = y0 + oy * ch / DIGIT_SIDE;
+        int yhi = std::max(ylo + 1, y0 + (oy + 1) * ch / DIGIT_SIDE);
+
+        std::fill(band.begin(), band.end(), 0);
+        for (int y = ylo; y < yhi; y++) {
+            const uint8_t* src = ink.data() + (size_t)y * width + x0;
+            for (int x = 0; x < cw; x++) band[x] += src[x];
+        }
+
+        for (int ox = 0; ox < DIGIT_SIDE; ox++) {
+            int xlo = ox * cw / DIGIT_SIDE;
+            int xhi = std::max(xlo + 1, (ox + 1) * cw / DIGIT_SIDE);
+
+            uint32_t sum = 0;
+            for (int x = xlo; x < xhi; x++) sum += band[x];
+
+            float v = sum / (255.0f * (xhi - xlo) * (yhi - ylo));
+            v = std::clamp((v - 0.5f) * CONTRAST + 0.5f, 0.0f, 1.0f);
+
+            int i = oy * DIGIT_SIDE + ox;
+            pixels[i] = (uint8_t)(v * 255.0f + 0.5f);
+            if (input) input[i] = pixels[i] / 255.0f;
+        }
+    }
+    return drawn;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+constexpr int DIGIT_SIDE = 28;
+constexpr int DIGIT_PIXELS = DIGIT_SIDE * DIGIT_SIDE;
+
+// Drawing canvas -> MNIST-style digit, entirely in memory.
+//
+// rgba is the canvas as RGBA8 (dark ink on a light background), bottom_up when rows are stored
+// last-first (raylib render textures). The ink's bounding box is padded by 20% to a centred
+// square, area-averaged down to 28x28, inverted (ink = 255) and contrast stretched the way the
+// old raylib pipeline did with ImageColorContrast(80).
+//
+// pixels receives 784 bytes and input (if not null) the same scaled to 0..1 for the network.
+// Returns false when nothing is drawn.
+bool preprocess_canvas(const uint8_t* rgba, int width, int height, bool bottom_up,
+                       uint8_t* pixels, float* input);
@@ -1,6 +1,12 @@
+SRC="./Predictor.cpp ../NN/neural_network.cpp ../NN/pruning.cpp ../Tensor/tensor.cpp \
+../Tensor/sparse_tensor.cpp ../Infer/inference_model.cpp ../Infer/freeze.cpp \
+../Infer/model_file.cpp ../Infer/model_watcher.cpp ../Filer.cpp ../Data/mapped_file.cpp \
+../Data/idx_dataset.cpp ../Data/dataset_cache.cpp ../Data/dataset.cpp ../Data/augment.cpp \
+../Data/stream_dataset.cpp ../Trace/trace.cpp preprocess.cpp"
+LIBS="-lraylib -lm -lpthread -ldl -lrt -lX11"
 
-g++ ./Predictor.cpp ../NN/neural_network.cpp ../Tensor/tensor.cpp ../Filer.cpp DrawWin.c \
--Iinclude \
--lraylib -lm -lpthread -ldl -lrt -lX11 \
--o app
+# drawing window
+g++ -O3 $SRC DrawWin.cpp -Iinclude $LIBS -o app
 
+# network visualizer, shows the drawing exported from app (E) with live activations
+g++ -O3 $SRC nn.cpp -Iinclude $LIBS -o nn
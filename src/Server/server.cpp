@@ -0,0 +1,572 @@
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include "../Data/csv.h"
+
+namespace {
+
+constexpr size_t MAX_HEADER_BYTES = 16 * 1024;
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i])) return false;
+    return true;
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r'))
+        s.remove_suffix(1);
+    return s;
+}
+
+std::string http_response(int status, const char* reason, const char* type,
+                          const std::string& body, bool keep_alive) {
+    std::string r = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n";
+    r += "Content-Type: ";
+    r += type;
+    r += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    r += keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    r += body;
+    return r;
+}
+
+}  // namespace
+
+PredictServer::PredictServer(std::shared_ptr<const InferenceModel> model, const ServerOptions& opts)
+    : m_model(std::move(model)), m_opts(opts) {
+    if (m_opts.workers <= 0)
+        m_opts.workers = (int)std::max(1u, std::thread::hardware_concurrency());
+    m_opts.max_batch = std::max(1, m_opts.max_batch);
+}
+
+PredictServer::~PredictServer() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers) t.join();
+
+    for (auto& [fd, conn] : m_conns) close(fd);
+    if (m_unix >= 0) {
+        close(m_unix);
+        unlink(m_opts.socket_path.c_str());
+    }
+    if (m_http >= 0) close(m_http);
+    if (m_wake >= 0) close(m_wake);
+    if (m_epoll >= 0) close(m_epoll);
+}
+
+// ---------------------------------------------------------------
+// Listeners
+// ---------------------------------------------------------------
+
+int PredictServer::listen_unix() {
+    sockaddr_un addr{};
+    if (m_opts.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << m_opts.socket_path << std::endl;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, m_opts.socket_path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    unlink(m_opts.socket_path.c_str());  // stale socket from an earlier run
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        std::cerr << "Cannot listen on " << m_opts.socket_path << ": " << std::strerror(errno)
+                  << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int PredictServer::listen_http() {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(m_opts.http_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // local use only
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        std::cerr << "Cannot listen on 127.0.0.1:" << m_opts.http_port << ": "
+                  << std::strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool PredictServer::start() {
+    if (m_opts.socket_path.empty() && m_opts.http_port <= 0) {
+        std::cerr << "Server needs a socket path or an HTTP port" << std::endl;
+        return false;
+    }
+
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll < 0 || m_wake < 0) {
+        std::cerr << "epoll / eventfd: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (!m_opts.socket_path.empty() && (m_unix = listen_unix()) < 0) return false;
+    if (m_opts.http_port > 0 && (m_http = listen_http()) < 0) return false;
+
+    for (int fd : {m_wake, m_unix, m_http}) {
+        if (fd < 0) continue;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    for (int i = 0; i < m_opts.workers; i++) m_workers.emplace_back(&PredictServer::worker, this);
+    return true;
+}
+
+void PredictServer::set_model(std::shared_ptr<const InferenceModel> model) {
+    std::atomic_store(&m_model, std::move(model));
+}
+
+void PredictServer::stop() {
+    m_stop = true;
+    uint64_t one = 1;
+    if (m_wake >= 0) (void)!write(m_wake, &one, sizeof(one));
+}
+
+// ---------------------------------------------------------------
+// Event loop
+// ---------------------------------------------------------------
+
+void PredictServer::run() {
+    epoll_event events[64];
+
+    while (!m_stop) {
+        int n = epoll_wait(m_epoll, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == m_wake) {
+                uint64_t count;
+                while (read(m_wake, &count, sizeof(count)) > 0) {
+                }
+                drain_completions();
+                continue;
+            }
+            if (fd == m_unix || fd == m_http) {
+                accept_all(fd, fd == m_http);
+                continue;
+            }
+
+            auto it = m_conns.find(fd);
+            if (it == m_conns.end()) continue;
+            Connection& conn = it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_connection(conn);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                flush(conn);
+                if (m_conns.find(fd) == m_conns.end()) continue;
+            }
+            if (events[i].events & EPOLLIN) on_readable(conn);
+        }
+    }
+}
+
+void PredictServer::accept_all(int listener, bool http) {
+    for (;;) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                std::cerr << "accept: " << std::strerror(errno) << std::endl;
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        Connection& conn = m_conns[fd];
+        conn = Connection{};
+        conn.fd = fd;
+        conn.id = m_next_id++;
+        conn.http = http;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+void PredictServer::on_readable(Connection& conn) {
+    char buf[64 * 1024];
+    for (;;) {
+        ssize_t r = read(conn.fd, buf, sizeof(buf));
+        if (r > 0) {
+            conn.in.append(buf, r);
+            continue;
+        }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (r < 0) {
+            close_connection(conn);
+            return;
+        }
+
+        // peer shut down its side: stop reading, but still answer the requests it sent
+        int fd = conn.fd;
+        conn.eof = true;
+        flush(conn);
+        if (m_conns.find(fd) == m_conns.end()) return;
+        break;
+    }
+    parse_requests(conn);
+}
+
+// Requests on one connection are answered in order: the next one is only parsed once the
+// previous reply has been queued.
+void PredictServer::parse_requests(Connection& conn) {
+    int fd = conn.fd;
+    while (!conn.busy && !conn.close_after) {
+        bool progressed = conn.http ? parse_http(conn) : parse_binary(conn);
+        if (m_conns.find(fd) == m_conns.end()) return;
+        if (!progressed) break;
+    }
+
+    // after EOF nothing more can complete a partial request; close once the replies are out
+    if (conn.eof && !conn.busy) {
+        conn.close_after = true;
+        if (conn.out.empty()) close_connection(conn);
+    }
+}
+
+bool PredictServer::parse_binary(Connection& conn) {
+    if (conn.in.size() < sizeof(uint32_t)) return false;
+
+    uint32_t n;
+    std::memcpy(&n, conn.in.data(), sizeof(n));
+    if (n == 0 || n > (uint32_t)m_opts.max_batch) {
+        std::cerr << "Closing connection: bad sample count " << n << std::endl;
+        close_connection(conn);
+        return false;
+    }
+
+    const int pixels = current_model()->input_size();
+    size_t need = sizeof(uint32_t) + (size_t)n * pixels;
+    if (conn.in.size() < need) return false;
+
+    Job job{conn.fd, conn.id, false, true, (int)n, std::vector<float>((size_t)n * pixels)};
+    const auto* px = reinterpret_cast<const uint8_t*>(conn.in.data() + sizeof(uint32_t));
+    for (size_t i = 0; i < job.input.size(); i++) job.input[i] = px[i] / 255.0f;
+    conn.in.erase(0, need);
+
+    conn.busy = true;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+bool PredictServer::parse_http(Connection& conn) {
+    size_t header_end = conn.in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        if (conn.in.size() > MAX_HEADER_BYTES) {
+            reply(conn, http_response(431, "Request Header Fields Too Large", "text/plain",
+                                      "header too large\n", false),
+                  true);
+        }
+        return false;
+    }
+
+    std::string_view head(conn.in.data(), header_end);
+    size_t eol = head.find("\r\n");
+    std::string_view request_line = head.substr(0, eol);
+    std::string_view headers = eol == std::string_view::npos ? "" : head.substr(eol + 2);
+
+    size_t sp1 = request_line.find(' ');
+    size_t sp2 = request_line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 <= sp1) {
+        reply(conn, http_response(400, "Bad Request", "text/plain", "bad request line\n", false),
+              true);
+        return false;
+    }
+    std::string_view method = request_line.substr(0, sp1);
+    std::string_view target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view version = request_line.substr(sp2 + 1);
+
+    bool keep_alive = version == "HTTP/1.1";
+    size_t content_length = 0;
+    while (!headers.empty()) {
+        size_t next = headers.find("\r\n");
+        std::string_view line = headers.substr(0, next);
+        headers = next == std::string_view::npos ? "" : headers.substr(next + 2);
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (iequals(name, "Content-Length")) {
+            auto [p, ec] = std::from_chars(value.data(), value.data() + value.size(),
+                                           content_length);
+            if (ec != std::errc()) content_length = SIZE_MAX;
+        } else if (iequals(name, "Connection")) {
+            if (iequals(value, "close")) keep_alive = false;
+            if (iequals(value, "keep-alive")) keep_alive = true;
+        }
+    }
+
+    // a 784 pixel row is at most ~3 KB of text
+    size_t max_body = (size_t)m_opts.max_batch * current_model()->input_size() * 4 + 1024;
+    if (content_length > max_body) {
+        reply(conn, http_response(413, "Payload Too Large", "text/plain", "body too large\n",
+                                  false),
+              true);
+        return false;
+    }
+
+    size_t total = header_end + 4 + content_length;
+    if (conn.in.size() < total) return false;
+
+    std::string body = conn.in.substr(header_end + 4, content_length);
+    std::string method_s(method), target_s(target);
+    conn.in.erase(0, total);
+
+    if (target_s == "/health") {
+        if (method_s != "GET") {
+            reply(conn, http_response(405, "Method Not Allowed", "text/plain", "use GET\n",
+                                      keep_alive),
+                  !keep_alive);
+        } else {
+            reply(conn, http_response(200, "OK", "text/plain", "ok\n", keep_alive), !keep_alive);
+        }
+        return true;
+    }
+    if (target_s != "/predict") {
+        reply(conn, http_response(404, "Not Found", "text/plain", "not found\n", keep_alive),
+              !keep_alive);
+        return true;
+    }
+    if (method_s != "POST") {
+        reply(conn, http_response(405, "Method Not Allowed", "text/plain", "use POST\n",
+                                  keep_alive),
+              !keep_alive);
+        return true;
+    }
+
+    // one sample per non-empty line; a leading label column (785 fields) is ignored
+    const int pixels = current_model()->input_size();
+    Job job{conn.fd, conn.id, true, keep_alive, 0, {}};
+    std::vector<float> row(pixels + 1);
+
+    const char* p = body.data();
+    const char* end = p + body.size();
+    while (p < end) {
+        CsvLine line;
+        p = csv_next_line(p, end, line);
+        if (line.begin == line.end) continue;
+
+        int fields = csv_floats(line.begin, line.end, row.data(), pixels + 1, 255.0f);
+        const float* px = fields == pixels + 1 ? row.data() + 1 : row.data();
+        if (fields != pixels && fields != pixels + 1) {
+            std::string msg = "sample " + std::to_string(job.n) + ": expected " +
+                              std::to_string(pixels) + " pixels, got " +
+                              std::to_string(std::max(0, fields)) + "\n";
+            reply(conn, http_response(400, "Bad Request", "text/plain", msg, keep_alive),
+                  !keep_alive);
+            return true;
+        }
+        if (job.n == m_opts.max_batch) {
+            reply(conn, http_response(413, "Payload Too Large", "text/plain",
+                                      "too many samples\n", keep_alive),
+                  !keep_alive);
+            return true;
+        }
+        job.input.insert(job.input.end(), px, px + pixels);
+        job.n++;
+    }
+
+    if (job.n == 0) {
+        reply(conn, http_response(400, "Bad Request", "text/plain", "empty body\n", keep_alive),
+              !keep_alive);
+        return true;
+    }
+
+    conn.busy = true;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+// ---------------------------------------------------------------
+// Responses
+// ---------------------------------------------------------------
+
+void PredictServer::reply(Connection& conn, std::string response, bool close_after) {
+    conn.out += response;
+    conn.close_after = conn.close_after || close_after;
+    flush(conn);
+}
+
+void PredictServer::flush(Connection& conn) {
+    while (!conn.out.empty()) {
+        ssize_t w = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (w > 0) {
+            conn.out.erase(0, w);
+            continue;
+        }
+        if (w < 0 && errno == EINTR) continue;
+        if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close_connection(conn);
+        return;
+    }
+
+    // wait for EPOLLOUT only while there is something left to send
+    epoll_event ev{};
+    ev.events = (conn.eof ? 0 : EPOLLIN) | (conn.out.empty() ? 0 : EPOLLOUT);
+    ev.data.fd = conn.fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, conn.fd, &ev);
+
+    if (conn.out.empty() && conn.close_after && !conn.busy) close_connection(conn);
+}
+
+void PredictServer::close_connection(Connection& conn) {
+    int fd = conn.fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    m_conns.erase(fd);
+}
+
+void PredictServer::drain_completions() {
+    std::vector<Done> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        done.swap(m_done);
+    }
+
+    for (Done& d : done) {
+        auto it = m_conns.find(d.fd);
+        if (it == m_conns.end() || it->second.id != d.conn_id) continue;  // client went away
+
+        Connection& conn = it->second;
+        conn.busy = false;
+        m_requests++;
+        reply(conn, std::move(d.response), d.close_after);
+
+        // pipelined requests may already be buffered
+        if (m_conns.find(d.fd) != m_conns.end()) parse_requests(it->second);
+    }
+}
+
+void PredictServer::worker() {
+    std::vector<float> probs;
+
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_shutdown || !m_jobs.empty(); });
+            if (m_shutdown) return;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        // a reload may swap the model meanwhile; this job finishes on the one it started with
+        std::shared_ptr<const InferenceModel> model = current_model();
+        probs.resize((size_t)job.n * model->output_size());
+        model->run(job.input.data(), job.n, probs.data());
+
+        const int classes = model->output_size();
+        Done done{job.fd, job.conn_id, !job.keep_alive, {}};
+        if (job.http) {
+            done.response = http_response(200, "OK", "application/json",
+                                          encode_json(probs.data(), job.n, classes),
+                                          job.keep_alive);
+        } else {
+            done.response = encode_binary(probs.data(), job.n, classes);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.push_back(std::move(done));
+        }
+        uint64_t one = 1;
+        (void)!write(m_wake, &one, sizeof(one));
+    }
+}
+
+std::string PredictServer::encode_binary(const float* probs, int n, int classes) {
+    std::string out(sizeof(uint32_t) + (size_t)n * (sizeof(int32_t) + classes * sizeof(float)),
+                    '\0');
+
+    char* p = out.data();
+    uint32_t count = n;
+    std::memcpy(p, &count, sizeof(count));
+    p += sizeof(count);
+
+    for (int s = 0; s < n; s++) {
+        const float* row = probs + (size_t)s * classes;
+        int32_t cls = (int32_t)(std::max_element(row, row + classes) - row);
+        std::memcpy(p, &cls, sizeof(cls));
+        p += sizeof(cls);
+        std::memcpy(p, row, classes * sizeof(float));
+        p += classes * sizeof(float);
+    }
+    return out;
+}
+
+std::string PredictServer::encode_json(const float* probs, int n, int classes) {
+    std::string out = "{\"predictions\":[";
+    char num[32];
+
+    for (int s = 0; s < n; s++) {
+        const float* row = probs + (size_t)s * classes;
+        int cls = (int)(std::max_element(row, row + classes) - row);
+
+        if (s) out += ',';
+        out += "{\"class\":" + std::to_string(cls) + ",\"probs\":[";
+        for (int c = 0; c < classes; c++) {
+            std::snprintf(num, sizeof(num), c ? ",%.6g" : "%.6g", row[c]);
+            out += num;
+        }
+        out += "]}";
+    }
+    out += "]}\n";
+    return out;
+}
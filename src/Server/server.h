@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../Infer/inference_model.h"
+
+struct ServerOptions {
+    std::string socket_path;  // Unix-domain socket, empty to disable
+    int http_port = 0;        // HTTP on 127.0.0.1, 0 to disable
+    int workers = 0;          // inference threads, 0 = hardware_concurrency
+    int max_batch = 256;      // samples accepted in one request
+};
+
+// Long-running prediction server. One epoll thread accepts connections and parses requests;
+// complete requests go to a pool of workers that run the shared InferenceModel and hand the
+// encoded response back to the event loop through an eventfd.
+//
+// Unix socket protocol (native byte order), any number of requests per connection:
+//   request:  u32 n | n * 784 u8 pixels
+//   response: u32 n | n * (i32 class | 10 f32 probabilities)
+//
+// HTTP/1.1 (keep-alive supported):
+//   GET  /health   -> "ok"
+//   POST /predict  body: one line of 784 comma separated pixels (0-255) per sample
+//                  -> {"predictions":[{"class":3,"probs":[...]}, ...]}
+class PredictServer {
+   public:
+    PredictServer(std::shared_ptr<const InferenceModel> model, const ServerOptions& opts);
+    ~PredictServer();
+
+    PredictServer(const PredictServer&) = delete;
+    PredictServer& operator=(const PredictServer&) = delete;
+
+    bool start();  // bind the listeners and start the workers; false (with a message) on error
+    void run();    // event loop, returns after stop()
+    void stop();   // safe to call from a signal handler
+
+    // Swap in a new model (e.g. from a ModelWatcher) with the same input / output sizes.
+    // Requests already with the workers finish on the old one.
+    void set_model(std::shared_ptr<const InferenceModel> model);
+    std::shared_ptr<const InferenceModel> current_model() const {
+        return std::atomic_load(&m_model);
+    }
+
+    long requests() const { return m_requests; }
+
+   private:
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;
+        bool http = false;
+        bool busy = false;         // a request of this connection is with the workers
+        bool close_after = false;  // close once `out` is flushed
+        bool eof = false;          // peer shut down its side; answer what is buffered
+        std::string in;
+        std::string out;
+    };
+
+    struct Job {
+        int fd;
+        uint64_t conn_id;
+        bool http;
+        bool keep_alive;
+        int n;
+        std::vector<float> input;  // n * input_size, sample-major, normalized
+    };
+
+    struct Done {
+        int fd;
+        uint64_t conn_id;
+        bool close_after;
+        std::string response;
+    };
+
+    int listen_unix();
+    int listen_http();
+    void accept_all(int listener, bool http);
+    void on_readable(Connection& conn);
+    void parse_requests(Connection& conn);
+    bool parse_binary(Connection& conn);
+    bool parse_http(Connection& conn);
+    void reply(Connection& conn, std::string response, bool close_after);
+    void flush(Connection& conn);
+    void close_connection(Connection& conn);
+    void drain_completions();
+    void worker();
+
+    static std::string encode_binary(const float* probs, int n, int classes);
+    static std::string encode_json(const float* probs, int n, int classes);
+
+    std::shared_ptr<const InferenceModel> m_model;  // only through atomic_load / atomic_store
+    ServerOptions m_opts;
+
+    int m_epoll = -1;
+    int m_wake = -1;  // eventfd: completions are ready or stop() was called
+    int m_unix = -1;
+    int m_http = -1;
+    std::atomic<bool> m_stop{false};
+
+    std::unordered_map<int, Connection> m_conns;
+    uint64_t m_next_id = 1;
+    long m_requests = 0;
+
+    std::vector<std::thread> m_workers;
+    std::deque<Job> m_jobs;
+    std::vector<Done> m_done;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_shutdown = false;
+};
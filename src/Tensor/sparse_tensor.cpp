@@ -0,0 +1,67 @@
+#include "sparse_tensor.h"
+
+#include <cmath>
+
+std::unique_ptr<SparseTensor> TtoSparse(const Tensor& t, float threshold) {
+    auto s = std::make_unique<SparseTensor>();
+    s->rows = t.rows;
+    s->cols = t.cols;
+    s->row_ptr.resize(t.rows + 1);
+
+    s->row_ptr[0] = 0;
+    for (int r = 0; r < t.rows; r++) {
+        const float* row = t.h_data + r * t.cols;
+        for (int c = 0; c < t.cols; c++) {
+            if (std::fabs(row[c]) > threshold) {
+                s->col_idx.push_back(c);
+                s->values.push_back(row[c]);
+            }
+        }
+        s->row_ptr[r + 1] = (int32_t)s->values.size();
+    }
+    return s;
+}
+
+std::unique_ptr<Tensor> TtoDense(const SparseTensor& s) {
+    auto t = std::make_unique<Tensor>(s.rows, s.cols);
+
+    for (int r = 0; r < s.rows; r++)
+        for (int p = s.row_ptr[r]; p < s.row_ptr[r + 1]; p++)
+            t->h_data[r * s.cols + s.col_idx[p]] = s.values[p];
+
+    return t;
+}
+
+std::unique_ptr<Tensor> TspMatmul(const SparseTensor& A, const Tensor& B) {
+    if (A.cols != B.rows) throw std::runtime_error("Sparse matmul shape mismatch");
+
+    int M = A.rows;
+    int N = B.cols;
+
+    auto C = std::make_unique<Tensor>(M, N);
+
+    const int32_t* row_ptr = A.row_ptr.data();
+    const int32_t* col_idx = A.col_idx.data();
+    const float* values = A.values.data();
+
+    if (N == 1) {
+        // GEMV: gather the input entries hit by each row
+        for (int i = 0; i < M; i++) {
+            float sum = 0.0f;
+            for (int p = row_ptr[i]; p < row_ptr[i + 1]; p++) sum += values[p] * B.h_data[col_idx[p]];
+            C->h_data[i] = sum;
+        }
+        return C;
+    }
+
+    // GEMM: every non-zero scales one contiguous row of B into the output row
+    for (int i = 0; i < M; i++) {
+        float* c_row = C->h_data + i * N;
+        for (int p = row_ptr[i]; p < row_ptr[i + 1]; p++) {
+            float a = values[p];
+            const float* b_row = B.h_data + col_idx[p] * N;
+            for (int j = 0; j < N; j++) c_row[j] += a * b_row[j];
+        }
+    }
+    return C;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensor.h"
+
+// Compressed sparse row (CSR) matrix used for pruned weight layers.
+// Only the non-zero values are stored together with their column indices;
+// row_ptr[r] .. row_ptr[r + 1] delimits the entries of row r.
+struct SparseTensor {
+    int rows = 0;
+    int cols = 0;
+
+    std::vector<int32_t> row_ptr;  // rows + 1 entries
+    std::vector<int32_t> col_idx;  // nnz entries
+    std::vector<float> values;     // nnz entries
+
+    inline int nnz() const { return (int)values.size(); }
+    inline float density() const {
+        return (rows > 0 && cols > 0) ? (float)nnz() / ((float)rows * cols) : 0.0f;
+    }
+    inline size_t bytes() const {
+        return row_ptr.size() * sizeof(int32_t) + col_idx.size() * sizeof(int32_t) +
+               values.size() * sizeof(float);
+    }
+};
+
+// conversion
+std::unique_ptr<SparseTensor> TtoSparse(const Tensor& t, float threshold = 0.0f);
+std::unique_ptr<Tensor> TtoDense(const SparseTensor& s);
+
+// C = A * B with A sparse (M x K) and B dense (K x N). N == 1 takes the GEMV path.
+std::unique_ptr<Tensor> TspMatmul(const SparseTensor& A, const Tensor& B);
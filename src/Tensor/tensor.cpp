@@ -1,3 +1,4 @@
+#include <cmath>
 #include <iomanip>
 
 #include "tensor.h"
@@ -287,9 +288,30 @@ int TArgmax(const Tensor& t) {
     return max_idx;
 }
 
+std::unique_ptr<Tensor> Ttanh(const Tensor& t) {
+    auto out = std::make_unique<Tensor>(t.rows, t.cols);
+    int size = t.rows * t.cols;
+    for (int i = 0; i < size; i++) out->h_data[i] = std::tanh(t.h_data[i]);
+    return out;
+}
+
 // debugging
-void TValidate(Tensor* t);
-bool TCheckDimension(Tensor* t);
+
+// true if t is a usable host tensor: non-null, positive shape, allocated
+bool TCheckDimension(Tensor* t) { return t && t->rows > 0 && t->cols > 0 && t->h_data; }
+
+// throws if t fails TCheckDimension or holds a NaN / Inf
+void TValidate(Tensor* t) {
+    if (!TCheckDimension(t))
+        throw std::runtime_error("Invalid tensor (null, empty or unallocated)");
+
+    int size = t->rows * t->cols;
+    for (int i = 0; i < size; i++) {
+        if (!std::isfinite(t->h_data[i]))
+            throw std::runtime_error("Non-finite value at (" + std::to_string(i / t->cols) + ", " +
+                                     std::to_string(i % t->cols) + ")");
+    }
+}
 
 void TPrint(const Tensor& t) {
     std::cout << "Tensor (" << t.rows << " x " << t.cols << ")\n";
@@ -0,0 +1,217 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace trace_detail {
+
+std::atomic<bool> enabled{false};
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+}  // namespace trace_detail
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* arg_name;
+    long arg;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+constexpr size_t CHUNK_EVENTS = 4096;
+constexpr size_t MAX_EVENTS = (size_t)1 << 20;  // per thread, ~40 MB
+
+struct Chunk {
+    Event events[CHUNK_EVENTS];
+    Chunk* next = nullptr;
+};
+
+// Written only by its thread. `count` is published with release after the event (and any new
+// chunk) is in place, so the writer of the file can read up to it while the thread runs on.
+struct ThreadBuffer {
+    int tid;
+    Chunk* head = nullptr;
+    Chunk* tail = nullptr;
+    std::atomic<size_t> count{0};
+    size_t first = 0;  // events before this one were recorded by the parent of a fork
+    size_t dropped = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadBuffer*> buffers;  // never freed: spans of finished threads stay
+    std::string path;
+    pid_t pid = 0;
+    uint64_t start_ns = 0;
+    bool written = false;
+};
+
+// leaked on purpose, thread_local buffers and the atexit writer may outlive static destructors
+Registry& registry() {
+    static Registry* r = new Registry();
+    return *r;
+}
+
+ThreadBuffer* thread_buffer() {
+    thread_local ThreadBuffer* buf = nullptr;
+    if (!buf) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        buf = new ThreadBuffer();
+        buf->tid = (int)r.buffers.size() + 1;
+        r.buffers.push_back(buf);
+    }
+    return buf;
+}
+
+void write_json_string(FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') std::fputc('\\', f);
+        std::fputc(*s, f);
+    }
+    std::fputc('"', f);
+}
+
+void write_trace() { trace_stop(); }
+
+// A forked child starts with copies of the parent's buffers; it only writes what it records
+// itself. The registry lock is held across fork() so the child never inherits it locked.
+void before_fork() { registry().mutex.lock(); }
+void after_fork_parent() { registry().mutex.unlock(); }
+void after_fork_child() {
+    Registry& r = registry();
+    for (ThreadBuffer* buf : r.buffers) {
+        buf->first = buf->count.load(std::memory_order_relaxed);
+        buf->dropped = 0;
+    }
+    r.mutex.unlock();
+}
+
+// MNIST_TRACE=file turns tracing on in every binary that links the spans
+struct EnvStart {
+    EnvStart() {
+        const char* path = std::getenv("MNIST_TRACE");
+        if (path && *path) trace_start(path);
+    }
+} env_start;
+
+}  // namespace
+
+void trace_detail::record(const char* name, const char* arg_name, long arg, uint64_t start_ns,
+                          uint64_t end_ns) {
+    ThreadBuffer* buf = thread_buffer();
+    size_t n = buf->count.load(std::memory_order_relaxed);
+    if (n >= MAX_EVENTS) {
+        buf->dropped++;
+        return;
+    }
+
+    size_t slot = n % CHUNK_EVENTS;
+    if (slot == 0) {
+        Chunk* chunk = new Chunk();
+        if (buf->tail)
+            buf->tail->next = chunk;
+        else
+            buf->head = chunk;
+        buf->tail = chunk;
+    }
+    buf->tail->events[slot] = {name, arg_name, arg, start_ns, end_ns};
+    buf->count.store(n + 1, std::memory_order_release);
+}
+
+bool trace_start(const std::string& path) {
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) {
+            std::cerr << "Trace: cannot create " << path << ", tracing stays off\n";
+            return false;
+        }
+        std::fclose(f);
+
+        bool first = r.path.empty();
+        r.path = path;
+        r.pid = getpid();
+        r.start_ns = trace_detail::now_ns();
+        r.written = false;
+        if (first) {
+            std::atexit(write_trace);
+            pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+        }
+    }
+    trace_detail::enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void trace_stop() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.path.empty()) return;
+
+    trace_detail::enabled.store(false, std::memory_order_relaxed);
+
+    pid_t pid = getpid();
+    if (pid == r.pid && r.written) return;
+    std::string path = pid == r.pid ? r.path : r.path + "." + std::to_string(pid);
+
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) {
+        std::cerr << "Trace: cannot write " << path << "\n";
+        return;
+    }
+
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+                    "\"args\":{\"name\":\"mnist %d\"}}",
+                 (int)pid, (int)pid);
+
+    size_t events = 0, dropped = 0;
+    for (ThreadBuffer* buf : r.buffers) {
+        size_t n = buf->count.load(std::memory_order_acquire);
+        const Chunk* chunk = buf->head;
+        for (size_t c = 0; c < buf->first / CHUNK_EVENTS; c++) chunk = chunk->next;
+        for (size_t i = buf->first; i < n; i++) {
+            if (i > buf->first && i % CHUNK_EVENTS == 0) chunk = chunk->next;
+            const Event& e = chunk->events[i % CHUNK_EVENTS];
+            if (e.start_ns < r.start_ns) continue;  // from before trace_start()
+
+            std::fprintf(f, ",\n{\"name\":");
+            write_json_string(f, e.name);
+            std::fprintf(f, ",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                         (int)pid, buf->tid, (e.start_ns - r.start_ns) * 1e-3,
+                         (e.end_ns - e.start_ns) * 1e-3);
+            if (e.arg_name) {
+                std::fprintf(f, ",\"args\":{");
+                write_json_string(f, e.arg_name);
+                std::fprintf(f, ":%ld}", e.arg);
+            }
+            std::fputc('}', f);
+            events++;
+        }
+        dropped += buf->dropped;
+    }
+    std::fprintf(f, "\n]}\n");
+    std::fclose(f);
+
+    if (pid == r.pid) r.written = true;
+    std::cerr << "Trace: " << events << " spans written to " << path;
+    if (dropped) std::cerr << " (" << dropped << " dropped, buffers full)";
+    std::cerr << "\n";
+}
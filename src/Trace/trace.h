@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped trace spans written as a Chrome trace-event JSON file, viewable in chrome://tracing
+// or ui.perfetto.dev.
+//
+// Tracing is off unless the MNIST_TRACE environment variable names an output file or
+// trace_start() is called (mnist --trace FILE). A disabled TRACE_SCOPE costs one relaxed
+// atomic load and a branch, so the spans stay in release builds.
+//
+// Every thread appends to its own buffer without locking; the file is written by trace_stop()
+// or at exit. Span names must be string literals (they are stored as pointers).
+
+namespace trace_detail {
+
+extern std::atomic<bool> enabled;
+
+uint64_t now_ns();
+void record(const char* name, const char* arg_name, long arg, uint64_t start_ns,
+            uint64_t end_ns);
+
+}  // namespace trace_detail
+
+// start collecting spans, written to `path` at exit; false if the file cannot be created
+bool trace_start(const std::string& path);
+// stop and write the file now (a forked child that leaves with _exit must call this itself;
+// it writes the spans it recorded after fork() to path.<pid>)
+void trace_stop();
+
+inline bool trace_enabled() { return trace_detail::enabled.load(std::memory_order_relaxed); }
+
+class TraceScope {
+   public:
+    explicit TraceScope(const char* name, const char* arg_name = nullptr, long arg = 0)
+        : m_name(trace_enabled() ? name : nullptr), m_arg_name(arg_name), m_arg(arg) {
+        if (m_name) m_start = trace_detail::now_ns();
+    }
+    ~TraceScope() {
+        if (m_name)
+            trace_detail::record(m_name, m_arg_name, m_arg, m_start, trace_detail::now_ns());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+   private:
+    const char* m_name;
+    const char* m_arg_name;
+    long m_arg;
+    uint64_t m_start = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// TRACE_SCOPE("forward") times the rest of the enclosing block;
+// TRACE_SCOPE_ARG("gemm", "layer", i) also shows {"layer": i} on the span
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg_name, arg) \
+    TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, arg_name, arg)
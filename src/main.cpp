@@ -1,10 +1,20 @@
 #include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <vector>
 
+#include "./Data/augment.h"
+#include "./Data/stream_dataset.h"
+#include "./Dist/data_parallel.h"
+#include "./NN/checkpoint.h"
+#include "./NN/checkpoint_writer.h"
 #include "./NN/neural_network.h"
+#include "./NN/pruning.h"
+#include "./NN/sweep.h"
+#include "./Trace/trace.h"
 #include "Filer.h"
 
 constexpr int TRAIN_SAMPLES = 800;
@@ -17,8 +27,128 @@ constexpr float LEARNING_RATE = 0.01;
 
 static const std::vector<int> LAYERS = {784, 512, 256, 10};
 
+// Magnitude pruning (--prune). Sparsity ramps up between the two epochs and the pruned
+// model is exported in CSR form next to the dense one.
+constexpr int PRUNE_BEGIN_EPOCH = 5;
+constexpr int PRUNE_END_EPOCH = 20;
+constexpr float PRUNE_ACC_TOLERANCE = 0.01f;
+
 namespace fs = std::filesystem;
 
+struct Options {
+    int procs = 1;
+    TransportKind transport = TransportKind::Shm;
+    std::string checkpoint = std::string(PROJECT_ROOT) + "/checkpoint.bin";
+    bool resume = false;
+
+    std::vector<std::string> stream;  // stream these CSVs instead of loading TRAIN_SAMPLES rows
+    std::string idx_images;           // train on an IDX image / label pair instead of the CSV
+    std::string idx_labels;
+    StreamOptions stream_opts;
+
+    float prune = 0.0f;  // target sparsity of magnitude pruning, 0 disables
+
+    bool augment = false;  // random affine + elastic distortions of the training images
+    AugmentOptions augment_opts;
+
+    std::string trace;  // Chrome trace-event JSON written at exit, also MNIST_TRACE=file
+
+    std::string sweep;  // hyperparameter sweep spec (NN/sweep.h) instead of one training run
+    std::string sweep_out = std::string(PROJECT_ROOT) + "/sweep_results.csv";
+    int sweep_workers = -1;  // overrides the spec's workers when set
+};
+
+void usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [options]\n"
+              << "  --procs N        data-parallel trainer processes on this machine (default 1)\n"
+              << "  --transport T    gradient allreduce transport between them (default shm)\n"
+              << "  --checkpoint P   training state written after every epoch (default "
+              << PROJECT_ROOT << "/checkpoint.bin, ranks > 0 append .<rank>)\n"
+              << "  --resume         continue from the checkpoint instead of starting over\n"
+              << "  --stream F[,F..] train on these CSVs streamed from disk (single process)\n"
+              << "  --stream-mb N    memory budget of the stream in MB (default 64)\n"
+              << "  --idx IMAGES,LABELS  train on an MNIST IDX image / label file pair\n"
+              << "  --shuffle N      stream shuffle buffer in samples (default 16384)\n"
+              << "  --prune S        magnitude-prune to sparsity S in [0, 1) between epochs "
+              << PRUNE_BEGIN_EPOCH << " and " << PRUNE_END_EPOCH << "\n"
+              << "                   and export the CSR model next to the dense one (default 0)\n"
+              << "  --augment        randomly shift, rotate, scale and distort training images\n"
+              << "  --aug-threads N  augmentation workers (default: all cores)\n"
+              << "  --seed N         augmentation seed (default 0)\n"
+              << "  --trace F        write a Chrome / Perfetto trace of the hot paths to F\n"
+              << "  --sweep SPEC     train every configuration of a sweep spec concurrently\n"
+              << "  --sweep-out F    ranked sweep results (default " << PROJECT_ROOT
+              << "/sweep_results.csv)\n"
+              << "  --sweep-workers N  concurrent sweep trials (default: the spec's, 0 = cores)\n";
+}
+
+Options parse_args(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--procs" && has_value) {
+            opts.procs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--transport" && has_value) {
+            std::string kind = argv[++i];
+            if (kind == "shm") {
+                opts.transport = TransportKind::Shm;
+            } else if (kind == "socket") {
+                opts.transport = TransportKind::Socket;
+            } else {
+                usage(argv[0]);
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (arg == "--checkpoint" && has_value) {
+            opts.checkpoint = argv[++i];
+        } else if (arg == "--resume") {
+            opts.resume = true;
+        } else if (arg == "--stream" && has_value) {
+            std::stringstream ss(argv[++i]);
+            std::string file;
+            while (std::getline(ss, file, ',')) opts.stream.push_back(file);
+        } else if (arg == "--idx" && has_value) {
+            std::string pair = argv[++i];
+            size_t comma = pair.find(',');
+            if (comma == std::string::npos || pair.find(',', comma + 1) != std::string::npos) {
+                usage(argv[0]);
+                std::exit(EXIT_FAILURE);
+            }
+            opts.idx_images = pair.substr(0, comma);
+            opts.idx_labels = pair.substr(comma + 1);
+        } else if (arg == "--stream-mb" && has_value) {
+            opts.stream_opts.memory_budget = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        } else if (arg == "--shuffle" && has_value) {
+            opts.stream_opts.shuffle_buffer = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--prune" && has_value) {
+            opts.prune = std::atof(argv[++i]);
+            if (!(opts.prune >= 0.0f && opts.prune < 1.0f)) {
+                usage(argv[0]);
+                std::exit(EXIT_FAILURE);
+            }
+        } else if (arg == "--augment") {
+            opts.augment = true;
+        } else if (arg == "--aug-threads" && has_value) {
+            opts.augment_opts.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && has_value) {
+            opts.augment_opts.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--trace" && has_value) {
+            opts.trace = argv[++i];
+        } else if (arg == "--sweep" && has_value) {
+            opts.sweep = argv[++i];
+        } else if (arg == "--sweep-out" && has_value) {
+            opts.sweep_out = argv[++i];
+        } else if (arg == "--sweep-workers" && has_value) {
+            opts.sweep_workers = std::max(0, std::atoi(argv[++i]));
+        } else {
+            usage(argv[0]);
+            std::exit(arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    return opts;
+}
+
 inline void check_file_exists(const std::string& path) {
     if (!fs::exists(path)) {
         std::cerr << "Error: File not found -> " << path << std::endl;
@@ -26,35 +156,140 @@ inline void check_file_exists(const std::string& path) {
     }
 }
 
-int main(int argc, char* argv[]) {
+// average predict() latency over the first n samples, in microseconds
+template <typename Net>
+double predict_latency_us(Net* net, const Dataset& dataset, int n) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < n; i++) {
+        auto img = Tflatten(*dataset.tensor(i));
+        predict(net, img.get());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / n;
+}
+
+void report_pruning(NeuralNetwork* net, SparseNetwork* sparse, const Dataset& val_data,
+                    float dense_acc) {
+    float sparse_acc = evaluate_accuracy(sparse, val_data, EVAL_SAMPLES);
+
+    size_t dense_bytes = 0;
+    for (size_t i = 0; i < net->weights.size(); i++)
+        dense_bytes += (net->weights[i]->size() + net->biases[i]->size()) * sizeof(float);
+
+    std::cout << "\nPruning report\n";
+    std::cout << "Sparsity: " << measure_sparsity(net) << "\n";
+    for (size_t i = 0; i < sparse->weights.size(); i++) {
+        const SparseLayer& layer = sparse->weights[i];
+        std::cout << "  layer " << i << ": density " << layer.sparse->density() << " kernel "
+                  << (layer.is_sparse() ? "csr" : "dense") << "\n";
+    }
+    std::cout << "Model size: " << dense_bytes << " -> " << sparse->bytes() << " bytes\n";
+    std::cout << "Predict latency: " << predict_latency_us(net, val_data, EVAL_SAMPLES) << " -> "
+              << predict_latency_us(sparse, val_data, EVAL_SAMPLES) << " us\n";
+    std::cout << "Accuracy (pre-pruning -> sparse): " << dense_acc << " -> " << sparse_acc << "\n";
+
+    if (dense_acc - sparse_acc > PRUNE_ACC_TOLERANCE) {
+        std::cerr << "Warning: pruned accuracy dropped by more than " << PRUNE_ACC_TOLERANCE
+                  << "\n";
+    }
+}
+
+// per-rank throughput and communication time for one epoch, printed by rank 0
+void report_ranks(DataParallel& dp, int samples, double seconds, double comm_seconds) {
+    auto throughput = dp.gather(samples / seconds);
+    auto comm = dp.gather(comm_seconds);
+    if (dp.rank() != 0) return;
+
+    float total = 0.0f;
+    for (int r = 0; r < dp.world(); r++) {
+        std::cout << "  rank " << r << ": " << throughput[r] << " samples/s, comm " << comm[r]
+                  << " s (" << 100.0 * comm[r] / seconds << "%)\n";
+        total += throughput[r];
+    }
+    std::cout << "  total: " << total << " samples/s\n";
+}
+
+// Runs the whole training job. With a transport this is one rank of a data-parallel job:
+// it trains on its shard of the training set and only rank 0 validates and saves.
+// Every rank writes its own resumable checkpoint after each epoch.
+int train(const Options& opts, Transport* transport) {
     const std::string project_root = PROJECT_ROOT;
 
     const std::string train_csv = project_root + "/data/mnist10k/train_final.csv";
     const std::string val_csv = project_root + "/data/mnist10k/val_final.csv";
     const std::string model_dir = project_root + "/testing";
 
-    check_file_exists(train_csv);
-    check_file_exists(val_csv);
+    int rank = transport ? transport->rank() : 0;
+    int world = transport ? transport->world() : 1;
+    bool lead = rank == 0;
 
-    Filer file;
+    std::string checkpoint_path = opts.checkpoint;
+    if (rank > 0) checkpoint_path += "." + std::to_string(rank);
 
-    std::cout << "Loading training data...\n";
-    auto train_data = file.get_data(train_csv, TRAIN_SAMPLES);
+    std::unique_ptr<Dataset> train_data;
+    std::unique_ptr<StreamDataset> stream;
+    if (!opts.stream.empty()) {
+        stream = std::make_unique<StreamDataset>(opts.stream, opts.stream_opts);
+        std::cout << "Streaming about " << stream->estimated_samples()
+                  << " samples, shuffle buffer " << stream->capacity() << "\n";
+    } else if (!opts.idx_images.empty()) {
+        std::cout << "Loading training data...\n";
+        auto idx = IdxDataset::open(opts.idx_images, opts.idx_labels);
+        if (!idx) return EXIT_FAILURE;
+        train_data = Dataset::from_idx(*idx, TRAIN_SAMPLES, rank, world);
+        if (train_data->empty() || train_data->pixels() != LAYERS.front()) {
+            std::cerr << "IDX images must be " << LAYERS.front() << " pixels\n";
+            return EXIT_FAILURE;
+        }
+    } else {
+        std::cout << "Loading training data...\n";
+        train_data = Dataset::from_csv(train_csv, TRAIN_SAMPLES, rank, world);
+        if (!train_data || train_data->empty()) return EXIT_FAILURE;
+    }
 
-    std::cout << "Loading validation data...\n";
-    auto val_data = file.get_data(val_csv, TEST_SAMPLES);
+    std::unique_ptr<Dataset> val_data;
+    if (lead) {
+        std::cout << "Loading validation data...\n";
+        val_data = Dataset::from_csv(val_csv, TEST_SAMPLES);
+    }
 
-    auto net = std::make_unique<NeuralNetwork>(LAYERS, LEARNING_RATE);
+    if (lead && !val_data) return EXIT_FAILURE;
+
+    int train_size = train_data ? train_data->size() : 0;  // streams keep no permutation
+    TrainState state(train_size);
+    std::vector<CheckpointBuffer> resumed;
+
+    std::unique_ptr<NeuralNetwork> net;
+    if (opts.resume) {
+        net.reset(load_checkpoint(checkpoint_path, state, resumed));
+        if (!net) return EXIT_FAILURE;
+        if (net->layers != LAYERS || (int)state.order.size() != train_size) {
+            std::cerr << "Checkpoint " << checkpoint_path << " does not match this run\n";
+            return EXIT_FAILURE;
+        }
+    } else {
+        net = std::make_unique<NeuralNetwork>(LAYERS, LEARNING_RATE);
+    }
+
+    std::unique_ptr<DataParallel> dp;
+    if (transport) {
+        dp = std::make_unique<DataParallel>(*transport, net.get());
+        if (dp->agree_min(state.epoch) != state.epoch) {
+            std::cerr << "Rank " << rank << ": rank checkpoints are from different epochs\n";
+            return EXIT_FAILURE;
+        }
+        dp->broadcast_params(net.get());
+    }
 
     // ---------------------------------------------------------------
     // Sanity check (one sample) — verifies training pipeline is valid
     // ---------------------------------------------------------------
-    {
+    if (!dp && train_data && !opts.resume) {
         std::cout << "\nSanity check before training\n";
 
-        auto& sample = train_data[0];
-        auto img = Tflatten(*sample.img_data);
-        auto label_onehot = Tonehot(sample.label);
+        int label = train_data->label(0);
+        auto img = Tflatten(*train_data->tensor(0));
+        auto label_onehot = Tonehot(label);
 
         auto p_before = predict(net.get(), img.get());
         float loss_before = cross_entropy_loss(*p_before, *label_onehot);
@@ -64,8 +299,7 @@ int main(int argc, char* argv[]) {
         auto p_after = predict(net.get(), img.get());
         float loss_after = cross_entropy_loss(*p_after, *label_onehot);
 
-        std::cout << "Initial prediction: " << TArgmax(*p_before) << " label: " << sample.label
-                  << "\n";
+        std::cout << "Initial prediction: " << TArgmax(*p_before) << " label: " << label << "\n";
 
         std::cout << "Loss before: " << loss_before << "\n";
         std::cout << "Loss after : " << loss_after << "\n";
@@ -74,17 +308,93 @@ int main(int argc, char* argv[]) {
     // ---------------------------------------------------------------
     // Training loop (mini-batch)
     // ---------------------------------------------------------------
-    float best_val = 0.0f;
+    std::unique_ptr<Pruner> pruner;
+    float dense_acc = 0.0f;
+    if (opts.prune > 0.0f) {
+        long samples = stream ? stream->estimated_samples()
+                       : dp   ? dp->agree_min(train_data->size())
+                              : train_data->size();
+        long steps_per_epoch = (samples + BATCH_SIZE - 1) / BATCH_SIZE;
+
+        PruneSchedule schedule;
+        schedule.target_sparsity = opts.prune;
+        schedule.begin_step = (PRUNE_BEGIN_EPOCH - 1) * steps_per_epoch;
+        schedule.end_step = PRUNE_END_EPOCH * steps_per_epoch;
+        schedule.frequency = std::max(1L, steps_per_epoch / 4);
+
+        pruner = std::make_unique<Pruner>(net.get(), schedule);
+    }
+
+    for (const auto& buffer : resumed) {
+        if (buffer.name == "pruner" && pruner && !pruner->deserialize(buffer.data)) {
+            std::cerr << "Checkpoint pruning state does not match this run\n";
+            return EXIT_FAILURE;
+        }
+        if (buffer.name == "dense_acc" && buffer.data.size() == sizeof(float))
+            std::memcpy(&dense_acc, buffer.data.data(), sizeof(float));
+    }
+
+    std::unique_ptr<Augmenter> augmenter;
+    if (opts.augment) augmenter = std::make_unique<Augmenter>(opts.augment_opts);
+
+    // best models and training state are written in the background so the next epoch
+    // starts right away
+    CheckpointWriter checkpoints(net.get(), 3);
+    auto save_state = [&]() {
+        std::vector<CheckpointBuffer> buffers;
+        if (pruner) {
+            const char* acc = reinterpret_cast<const char*>(&dense_acc);
+            buffers.push_back({"pruner", pruner->serialize()});
+            buffers.push_back({"dense_acc", std::vector<char>(acc, acc + sizeof(float))});
+        }
+        checkpoints.save_checkpoint(net.get(), state, buffers, checkpoint_path);
+    };
+
     auto total_start = std::chrono::high_resolution_clock::now();
 
-    for (int epoch = 1; epoch <= EPOCHS; epoch++) {
+    for (int epoch = state.epoch + 1; epoch <= EPOCHS; epoch++) {
         auto epoch_start = std::chrono::high_resolution_clock::now();
 
-        std::cout << "\nEpoch " << epoch << " / " << EPOCHS << "\n";
+        if (lead) std::cout << "\nEpoch " << epoch << " / " << EPOCHS << "\n";
 
-        Train_batch_imgs(net.get(), train_data, BATCH_SIZE);
+        if (dp) {
+            double comm_before = dp->comm_seconds;
+            Train_batch_imgs(net.get(), *train_data, BATCH_SIZE, state, *dp, pruner.get());
 
-        float acc = evaluate_accuracy(net.get(), val_data, EVAL_SAMPLES);
+            double comm = dp->comm_seconds - comm_before;
+            double train_seconds = std::chrono::duration<double>(
+                                       std::chrono::high_resolution_clock::now() - epoch_start)
+                                       .count();
+            report_ranks(*dp, dp->agree_min(train_data->size()), train_seconds, comm);
+            if (!lead) {
+                state.epoch = epoch;
+                save_state();
+                continue;
+            }
+        } else if (stream) {
+            Train_batch_imgs(net.get(), *stream, BATCH_SIZE, state, pruner.get());
+
+            double train_seconds = std::chrono::duration<double>(
+                                       std::chrono::high_resolution_clock::now() - epoch_start)
+                                       .count();
+            std::cout << "Streamed " << stream->samples() << " samples ("
+                      << stream->samples() / train_seconds << " samples/s, "
+                      << stream->read_seconds() << " s reading), RSS "
+                      << resident_bytes() / (1 << 20) << " MB\n";
+        } else if (augmenter) {
+            double stall_before = augmenter->stall_seconds();
+            Train_batch_imgs(net.get(), *train_data, BATCH_SIZE, state, *augmenter, pruner.get());
+            std::cout << "Augmented on " << augmenter->threads() << " threads, training waited "
+                      << augmenter->stall_seconds() - stall_before << " s\n";
+        } else {
+            Train_batch_imgs(net.get(), *train_data, BATCH_SIZE, state, pruner.get());
+        }
+
+        float acc = evaluate_accuracy(net.get(), *val_data, EVAL_SAMPLES);
+        if (pruner) {
+            if (epoch == PRUNE_BEGIN_EPOCH - 1) dense_acc = acc;
+            std::cout << "Sparsity: " << pruner->current_sparsity() << "\n";
+        }
 
         auto epoch_end = std::chrono::high_resolution_clock::now();
         double seconds =
@@ -94,20 +404,114 @@ int main(int argc, char* argv[]) {
         std::cout << "Validation accuracy: " << acc << "\n";
         std::cout << "Epoch time: " << seconds << " seconds\n";
 
-        if (acc > best_val) {
-            best_val = acc;
+        if (acc > state.best_val) {
+            state.best_val = acc;
             std::cout << "New best model saved\n";
-            save(net.get(), model_dir);
+            checkpoints.save(net.get(), model_dir);
         }
+
+        state.epoch = epoch;
+        save_state();
     }
 
+    checkpoints.flush();
+    if (!lead) return 0;
+
     auto total_end = std::chrono::high_resolution_clock::now();
     double total_seconds =
         std::chrono::duration_cast<std::chrono::duration<double>>(total_end - total_start).count();
 
     std::cout << "\nTraining complete\n";
-    std::cout << "Best validation accuracy: " << best_val << "\n";
+    std::cout << "Best validation accuracy: " << state.best_val << "\n";
     std::cout << "Total training time: " << total_seconds << " seconds\n";
 
+    std::cout << "Checkpoints: " << checkpoints.written() << " written, "
+              << checkpoints.superseded() << " superseded, " << checkpoints.stall_seconds()
+              << " s on the training thread, " << checkpoints.write_seconds()
+              << " s in the writer\n";
+
+    if (pruner) {
+        std::unique_ptr<SparseNetwork> sparse(Sparsify(net.get()));
+        report_pruning(net.get(), sparse.get(), *val_data, dense_acc);
+        save_sparse(sparse.get(), model_dir + "_sparse");
+    }
+
+    return 0;
+}
+
+// Loads the data once and trains every configuration of the sweep spec on it concurrently,
+// then prints and saves the results ranked by validation accuracy.
+int sweep(const Options& opts) {
+    const std::string project_root = PROJECT_ROOT;
+
+    SweepSpec spec;
+    if (!load_sweep_spec(opts.sweep, spec)) return EXIT_FAILURE;
+    if (opts.sweep_workers >= 0) spec.options.workers = opts.sweep_workers;
+
+    int train_samples = spec.train_samples > 0 ? spec.train_samples : TRAIN_SAMPLES;
+    auto train_data =
+        Dataset::from_csv(project_root + "/data/mnist10k/train_final.csv", train_samples);
+    auto val_data =
+        Dataset::from_csv(project_root + "/data/mnist10k/val_final.csv", spec.options.val_samples);
+    if (!train_data || train_data->empty() || !val_data || val_data->empty()) return EXIT_FAILURE;
+
+    for (const auto& config : spec.configs) {
+        if (config.layers.front() != train_data->pixels() || config.layers.back() != 10) {
+            std::cerr << "Sweep layers must run from " << train_data->pixels()
+                      << " inputs to 10 classes\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto results = run_sweep(spec.configs, spec.options, *train_data, *val_data);
+    print_sweep_results(results, spec.options, std::cout);
+    if (!save_sweep_results(results, opts.sweep_out)) return EXIT_FAILURE;
+    std::cout << "Results written to " << opts.sweep_out << "\n";
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+    Options opts = parse_args(argc, argv);
+
+    const std::string project_root = PROJECT_ROOT;
+    check_file_exists(project_root + "/data/mnist10k/train_final.csv");
+    check_file_exists(project_root + "/data/mnist10k/val_final.csv");
+
+    if (opts.procs > 1 && (!opts.stream.empty() || opts.augment)) {
+        std::cerr << "--stream and --augment train in a single process\n";
+        return EXIT_FAILURE;
+    }
+    if (!opts.sweep.empty()) {
+        if (opts.procs > 1 || opts.resume || opts.augment || !opts.stream.empty() ||
+            !opts.idx_images.empty()) {
+            std::cerr << "--sweep runs alone, without --procs, --resume, --augment, --stream or "
+                         "--idx\n";
+            return EXIT_FAILURE;
+        }
+        if (!opts.trace.empty() && !trace_start(opts.trace)) return EXIT_FAILURE;
+        return sweep(opts);
+    }
+    if (opts.augment && !opts.stream.empty()) {
+        std::cerr << "--augment works on the in-memory dataset, not with --stream\n";
+        return EXIT_FAILURE;
+    }
+    if (!opts.idx_images.empty() && !opts.stream.empty()) {
+        std::cerr << "--idx and --stream are two sources of training data, pick one\n";
+        return EXIT_FAILURE;
+    }
+    for (const auto& file : opts.stream) check_file_exists(file);
+    if (!opts.idx_images.empty()) {
+        check_file_exists(opts.idx_images);
+        check_file_exists(opts.idx_labels);
+    }
+    if (!opts.trace.empty() && !trace_start(opts.trace)) return EXIT_FAILURE;
+
+    if (opts.procs > 1) {
+        std::cout << "Launching " << opts.procs << " data-parallel trainers ("
+                  << (opts.transport == TransportKind::Shm ? "shm" : "socket") << ")\n";
+        return launch_data_parallel(opts.procs, opts.transport,
+                                    [&](Transport& t) { return train(opts, &t); });
+    }
+
+    return train(opts, nullptr);
+}
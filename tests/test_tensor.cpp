@@ -0,0 +1,763 @@
+// Differential tests of the numeric kernels.
+//
+//   test_tensor [--seed N] [--shapes N]
+//
+// Every op of Tensor/tensor.h (plus TaddBias) runs on random shapes, mixed with 1, primes and
+// sizes just around power-of-two tile widths, and is compared against a slow double precision
+// reference: bit-exact for the ops that round once per element, within a few ULP or a relative
+// bound for exp / tanh, and within the K * eps * sum|a*b| error bound for the reductions.
+// backward_pass_batch is checked against central finite differences of the loss, and the
+// packed InferenceModel against the reference forward pass. The model, CSR and IDX loaders
+// must reject files whose shapes disagree with their headers.
+//
+// Failures print the op, the shape, the worst element and the seed to reproduce them; the
+// exit code is 1 if any check failed.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Data/augment.h"
+#include "Data/dataset.h"
+#include "Infer/inference_model.h"
+#include "Infer/model_watcher.h"
+#include "NN/low_rank.h"
+#include "NN/neural_network.h"
+#include "NN/pruning.h"
+#include "Tensor/tensor.h"
+
+namespace {
+
+uint64_t g_seed = 1;
+int g_checks = 0;
+int g_failures = 0;
+
+std::mt19937_64 rng;
+
+void fail(const std::string& what) {
+    g_failures++;
+    std::cerr << "FAIL " << what << " (seed " << g_seed << ")\n";
+}
+
+bool check(bool ok, const std::string& what) {
+    g_checks++;
+    if (!ok) fail(what);
+    return ok;
+}
+
+template <typename Fn>
+bool throws(Fn&& fn) {
+    try {
+        fn();
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+std::string dims(int r, int c) { return std::to_string(r) + "x" + std::to_string(c); }
+
+// ---------------------------------------------------------------
+// Random data
+// ---------------------------------------------------------------
+
+const int EDGE_SIZES[] = {1, 2, 3, 4, 5, 7, 8, 13, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 257};
+
+int random_size(int max = 300) {
+    if (rng() % 2) {
+        int n = EDGE_SIZES[rng() % (sizeof(EDGE_SIZES) / sizeof(int))];
+        if (n <= max) return n;
+    }
+    return 1 + (int)(rng() % max);
+}
+
+Tensor random_tensor(int r, int c, float lo = -1.0f, float hi = 1.0f) {
+    Tensor t(r, c);
+    std::uniform_real_distribution<float> dist(lo, hi);
+    for (int i = 0; i < t.size(); i++) t.h_data[i] = dist(rng);
+    // exact zeros exercise the ReLU branches
+    if (t.size() > 4) t.h_data[rng() % t.size()] = 0.0f;
+    return t;
+}
+
+// ---------------------------------------------------------------
+// Comparison
+// ---------------------------------------------------------------
+
+// distance in representable floats, so 1 = adjacent values
+int64_t ulp_distance(float a, float b) {
+    if (a == b) return 0;
+    if (std::isnan(a) || std::isnan(b)) return std::numeric_limits<int64_t>::max();
+    auto ordered = [](float f) {
+        int32_t i;
+        std::memcpy(&i, &f, sizeof(i));
+        return i < 0 ? (int64_t)INT32_MIN - i : (int64_t)i;
+    };
+    return std::llabs(ordered(a) - ordered(b));
+}
+
+struct Tolerance {
+    int64_t ulps = 0;   // always fine within this many ULP of the rounded reference
+    double rel = 0.0;   // ... or within abs + rel * |reference|
+    double abs = 0.0;
+};
+
+const Tolerance EXACT{0, 0.0, 0.0};
+
+// got vs reference[i]; `bound` (optional) is a per-element absolute error bound
+bool compare(const std::string& op, const Tensor& got, int rows, int cols,
+             const std::vector<double>& ref, const Tolerance& tol,
+             const std::vector<double>* bound = nullptr) {
+    std::string shape = dims(rows, cols);
+    if (!check(got.rows == rows && got.cols == cols,
+               op + ": shape " + dims(got.rows, got.cols) + ", expected " + shape))
+        return false;
+
+    int worst = -1;
+    double worst_err = 0.0;
+    for (int i = 0; i < got.size(); i++) {
+        float g = got.h_data[i];
+        double r = ref[i];
+        double err = std::abs((double)g - r);
+
+        bool ok = ulp_distance(g, (float)r) <= tol.ulps ||
+                  err <= tol.abs + tol.rel * std::abs(r) || (bound && err <= (*bound)[i]);
+        if (!ok && (worst < 0 || err > worst_err)) {
+            worst = i;
+            worst_err = err;
+        }
+    }
+    if (worst < 0) return check(true, op);
+
+    std::ostringstream msg;
+    msg.precision(9);
+    msg << op << " " << shape << ": element (" << worst / cols << ", " << worst % cols
+        << ") = " << got.h_data[worst] << ", reference " << ref[worst] << ", "
+        << ulp_distance(got.h_data[worst], (float)ref[worst]) << " ULP";
+    return check(false, msg.str());
+}
+
+// ---------------------------------------------------------------
+// Reference implementations (double, the obvious loops)
+// ---------------------------------------------------------------
+
+std::vector<double> ref_map(const Tensor& a, const std::function<double(double)>& f) {
+    std::vector<double> out(a.size());
+    for (int i = 0; i < a.size(); i++) out[i] = f(a.h_data[i]);
+    return out;
+}
+
+std::vector<double> ref_zip(const Tensor& a, const Tensor& b,
+                            const std::function<double(double, double)>& f) {
+    std::vector<double> out(a.size());
+    for (int i = 0; i < a.size(); i++) out[i] = f(a.h_data[i], b.h_data[i]);
+    return out;
+}
+
+// C = A * B and the bound 2 K eps sum|a b| of a float dot product in any order
+void ref_matmul(const Tensor& A, const Tensor& B, std::vector<double>& C,
+                std::vector<double>& bound) {
+    int M = A.rows, K = A.cols, N = B.cols;
+    C.assign((size_t)M * N, 0.0);
+    bound.assign((size_t)M * N, 0.0);
+    for (int i = 0; i < M; i++)
+        for (int j = 0; j < N; j++) {
+            double sum = 0.0, abs_sum = 0.0;
+            for (int p = 0; p < K; p++) {
+                double prod = (double)A.h_data[i * K + p] * B.h_data[p * N + j];
+                sum += prod;
+                abs_sum += std::abs(prod);
+            }
+            C[(size_t)i * N + j] = sum;
+            bound[(size_t)i * N + j] = 2.0 * K * FLT_EPSILON * abs_sum + FLT_MIN;
+        }
+}
+
+std::vector<double> ref_softmax(const Tensor& t, bool cols) {
+    int outer = cols ? t.cols : t.rows;
+    int inner = cols ? t.rows : t.cols;
+    auto at = [&](int o, int i) { return cols ? i * t.cols + o : o * t.cols + i; };
+
+    std::vector<double> out(t.size());
+    for (int o = 0; o < outer; o++) {
+        double maxv = -INFINITY;
+        for (int i = 0; i < inner; i++) maxv = std::max(maxv, (double)t.h_data[at(o, i)]);
+        double sum = 0.0;
+        for (int i = 0; i < inner; i++) sum += std::exp(t.h_data[at(o, i)] - maxv);
+        for (int i = 0; i < inner; i++) out[at(o, i)] = std::exp(t.h_data[at(o, i)] - maxv) / sum;
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------
+// Tensor ops
+// ---------------------------------------------------------------
+
+void test_elementwise(int r, int c) {
+    Tensor a = random_tensor(r, c), b = random_tensor(r, c);
+    float k = std::uniform_real_distribution<float>(-3.0f, 3.0f)(rng);
+
+    compare("Tcopy", *Tcopy(a), r, c, ref_map(a, [](double x) { return x; }), EXACT);
+    compare("Tflatten", *Tflatten(a), r * c, 1, ref_map(a, [](double x) { return x; }), EXACT);
+    compare("Tadd", *Tadd(a, b), r, c, ref_zip(a, b, std::plus<double>()), EXACT);
+    compare("Tsub", *Tsub(a, b), r, c, ref_zip(a, b, std::minus<double>()), EXACT);
+    compare("Tmul", *Tmul(a, b), r, c, ref_zip(a, b, std::multiplies<double>()), EXACT);
+    compare("TmulScalar", *TmulScalar(a, k), r, c, ref_map(a, [k](double x) { return x * k; }),
+            EXACT);
+    compare("TaddScalar", *TaddScalar(a, k), r, c, ref_map(a, [k](double x) { return x + k; }),
+            EXACT);
+
+    Tensor relu = a;
+    TRelu(relu);
+    compare("TRelu", relu, r, c, ref_map(a, [](double x) { return x < 0 ? 0.0 : x; }), EXACT);
+    Tensor relu_prime = a;
+    TReluPrime(relu_prime);
+    compare("TReluPrime", relu_prime, r, c, ref_map(a, [](double x) { return x > 0 ? 1.0 : 0.0; }),
+            EXACT);
+
+    // wide range, into the saturated tails
+    Tensor x = random_tensor(r, c, -20.0f, 20.0f);
+    const Tolerance transcendental{4, 1e-6, 1e-7};
+    auto sigmoid = [](double v) { return 1.0 / (1.0 + std::exp(-v)); };
+    compare("TSigmoid", *TSigmoid(x), r, c, ref_map(x, sigmoid), transcendental);
+    // s * (1 - s) in float loses the relative precision of 1 - s once s rounds near 1
+    compare("TSigmoidPrime", *TSigmoidPrime(x), r, c,
+            ref_map(x, [&](double v) { return sigmoid(v) * (1.0 - sigmoid(v)); }),
+            {4, 1e-5, 1e-7});
+    compare("Ttanh", *Ttanh(x), r, c, ref_map(x, [](double v) { return std::tanh(v); }),
+            transcendental);
+
+    std::vector<double> t(a.size());
+    for (int i = 0; i < r; i++)
+        for (int j = 0; j < c; j++) t[(size_t)j * r + i] = a.h_data[i * c + j];
+    compare("Ttranspose", *Ttranspose(a), c, r, t, EXACT);
+
+    std::vector<double> sums(r, 0.0), bound(r, 0.0);
+    for (int i = 0; i < r; i++)
+        for (int j = 0; j < c; j++) {
+            sums[i] += a.h_data[i * c + j];
+            bound[i] += std::abs(a.h_data[i * c + j]);
+        }
+    for (double& v : bound) v *= 2.0 * c * FLT_EPSILON;
+    compare("TsumCols", *TsumCols(a), r, 1, sums, EXACT, &bound);
+
+    Tensor bias = random_tensor(r, 1);
+    std::vector<double> biased(a.size());
+    for (int i = 0; i < a.size(); i++) biased[i] = (double)a.h_data[i] + bias.h_data[i / c];
+    compare("TaddBias", *TaddBias(a, bias), r, c, biased, EXACT);
+
+    // logits far apart stress the max subtraction
+    Tensor logits = random_tensor(r, c, -50.0f, 50.0f);
+    const Tolerance softmax{8, 1e-5, 1e-7};
+    Tensor rows = logits;
+    TSoftmaxRows(rows);
+    compare("TSoftmaxRows", rows, r, c, ref_softmax(logits, c == 1), softmax);
+    Tensor cols = logits;
+    TSoftmaxCols(cols);
+    compare("TSoftmaxCols", cols, r, c, ref_softmax(logits, true), softmax);
+}
+
+void test_matmul(int M, int K, int N) {
+    Tensor A = random_tensor(M, K), B = random_tensor(K, N);
+    std::vector<double> ref, bound;
+    ref_matmul(A, B, ref, bound);
+    compare("Tmatmul " + dims(M, K) + "*" + dims(K, N), *Tmatmul(A, B), M, N, ref, EXACT,
+            &bound);
+}
+
+void test_vectors(int n) {
+    Tensor v = random_tensor(n, 1);
+    if (n > 2) v.h_data[n - 1] = v.h_data[n / 2] = 2.0f;  // tie: the first maximum wins
+    int expected = 0;
+    for (int i = 1; i < n; i++)
+        if (v.h_data[i] > v.h_data[expected]) expected = i;
+    check(TArgmax(v) == expected, "TArgmax " + dims(n, 1));
+
+    for (int label = 0; label < 10; label++) {
+        auto onehot = Tonehot(label);
+        std::vector<double> ref(10, 0.0);
+        ref[label] = 1.0;
+        compare("Tonehot", *onehot, 10, 1, ref, EXACT);
+    }
+}
+
+void test_randomize(int r, int c) {
+    Tensor t(r, c);
+    float fan_in = (float)c;
+    TRandomize(t, fan_in);
+    float bound = std::sqrt(6.0f / fan_in);
+    bool in_range = true, varied = t.size() == 1;
+    for (int i = 0; i < t.size(); i++) {
+        in_range &= std::abs(t.h_data[i]) <= bound;
+        varied |= t.h_data[i] != t.h_data[0];
+    }
+    check(in_range && varied, "TRandomize " + dims(r, c) + " within +-sqrt(6 / fan_in)");
+    check(throws([&] { TRandomize(t, 0.0f); }), "TRandomize rejects fan_in 0");
+}
+
+void test_validation() {
+    Tensor ok = random_tensor(3, 4);
+    check(TCheckDimension(&ok), "TCheckDimension accepts a valid tensor");
+    check(!throws([&] { TValidate(&ok); }), "TValidate accepts a valid tensor");
+
+    Tensor moved = std::move(ok);
+    check(!TCheckDimension(&ok), "TCheckDimension rejects a moved-from tensor");
+    check(throws([&] { TValidate(&ok); }), "TValidate rejects a moved-from tensor");
+    check(!TCheckDimension(nullptr) && throws([] { TValidate(nullptr); }),
+          "TCheckDimension / TValidate reject nullptr");
+
+    moved.h_data[5] = std::numeric_limits<float>::quiet_NaN();
+    check(throws([&] { TValidate(&moved); }), "TValidate rejects NaN");
+    moved.h_data[5] = std::numeric_limits<float>::infinity();
+    check(throws([&] { TValidate(&moved); }), "TValidate rejects Inf");
+
+    Tensor a(2, 3), b(3, 2);
+    check(throws([&] { Tadd(a, b); }) && throws([&] { Tsub(a, b); }) &&
+              throws([&] { Tmul(a, b); }),
+          "elementwise ops reject mismatched shapes");
+    check(throws([&] { Tmatmul(a, a); }), "Tmatmul rejects mismatched inner dimensions");
+    check(throws([&] { TaddBias(a, Tensor(3, 1)); }), "TaddBias rejects a wrong bias shape");
+    check(throws([] { Tensor(0, 3); }) && throws([] { Tensor(3, -1); }),
+          "Tensor rejects non-positive sizes");
+    check(throws([&] { TArgmax(a); }), "TArgmax rejects a matrix");
+}
+
+// ---------------------------------------------------------------
+// Training and inference against a double precision network
+// ---------------------------------------------------------------
+
+struct RefNet {
+    std::vector<int> layers;
+    std::vector<std::vector<double>> W, b;  // W[l] is (out x in) row-major
+
+    explicit RefNet(const NeuralNetwork& net) : layers(net.layers) {
+        for (size_t l = 0; l + 1 < layers.size(); l++) {
+            W.emplace_back(net.weights[l]->h_data,
+                           net.weights[l]->h_data + net.weights[l]->size());
+            b.emplace_back(net.biases[l]->h_data, net.biases[l]->h_data + net.biases[l]->size());
+        }
+    }
+
+    // softmax probabilities of one sample, ReLU hidden layers
+    std::vector<double> forward(const std::vector<double>& x) const {
+        std::vector<double> a = x;
+        for (size_t l = 0; l < W.size(); l++) {
+            int in = layers[l], out = layers[l + 1];
+            std::vector<double> z(out);
+            for (int o = 0; o < out; o++) {
+                double s = b[l][o];
+                for (int i = 0; i < in; i++) s += W[l][(size_t)o * in + i] * a[i];
+                z[o] = s;
+            }
+            if (l + 1 == W.size()) {
+                double maxv = *std::max_element(z.begin(), z.end()), sum = 0.0;
+                for (double& v : z) sum += (v = std::exp(v - maxv));
+                for (double& v : z) v /= sum;
+            } else {
+                for (double& v : z) v = std::max(0.0, v);
+            }
+            a = std::move(z);
+        }
+        return a;
+    }
+
+    // mean cross-entropy over the columns of X (features x batch) with integer labels
+    double loss(const Tensor& X, const std::vector<int>& labels) const {
+        double total = 0.0;
+        for (int s = 0; s < X.cols; s++) {
+            std::vector<double> x(X.rows);
+            for (int i = 0; i < X.rows; i++) x[i] = X.h_data[i * X.cols + s];
+            total -= std::log(forward(x)[labels[s]]);
+        }
+        return total / X.cols;
+    }
+};
+
+// seeded, at the scale TRandomize uses, so the logits stay in a realistic range
+void randomize_net(NeuralNetwork& net) {
+    for (size_t l = 0; l < net.weights.size(); l++) {
+        float bound = std::sqrt(6.0f / net.layers[l]);
+        *net.weights[l] = random_tensor(net.weights[l]->rows, net.weights[l]->cols, -bound, bound);
+        *net.biases[l] = random_tensor(net.biases[l]->rows, 1, -0.5f, 0.5f);
+    }
+}
+
+void test_gradients(const std::vector<int>& layers, int batch) {
+    std::string name = "backward_pass_batch";
+    for (int n : layers) name += " " + std::to_string(n);
+    name += " batch " + std::to_string(batch);
+
+    NeuralNetwork net(layers, 0.1f);
+    randomize_net(net);
+
+    Tensor X = random_tensor(layers.front(), batch, 0.0f, 1.0f);
+    Tensor Y(layers.back(), batch);
+    std::vector<int> labels(batch);
+    for (int s = 0; s < batch; s++) {
+        labels[s] = rng() % layers.back();
+        Y.h_data[labels[s] * batch + s] = 1.0f;
+    }
+
+    RefNet ref(net);
+    ForwardCache cache = forward_pass_batch(&net, &X);
+
+    // the forward pass itself
+    std::vector<double> probs((size_t)layers.back() * batch);
+    for (int s = 0; s < batch; s++) {
+        std::vector<double> x(X.rows);
+        for (int i = 0; i < X.rows; i++) x[i] = X.h_data[i * batch + s];
+        auto p = ref.forward(x);
+        for (int c = 0; c < layers.back(); c++) probs[(size_t)c * batch + s] = p[c];
+    }
+    compare("forward_pass_batch", *cache.activations.back(), layers.back(), batch, probs,
+            {16, 1e-4, 1e-6});
+
+    BackwardCache grads = backward_pass_batch(&net, cache, &Y);
+
+    // central differences of the double loss, parameter by parameter
+    const double h = 1e-5;
+    for (size_t l = 0; l < ref.W.size(); l++) {
+        for (int which = 0; which < 2; which++) {
+            std::vector<double>& param = which ? ref.b[l] : ref.W[l];
+            const Tensor& grad = which ? *grads.dB[l] : *grads.dW[l];
+
+            std::vector<double> numeric(param.size());
+            for (size_t i = 0; i < param.size(); i++) {
+                double saved = param[i];
+                param[i] = saved + h;
+                double up = ref.loss(X, labels);
+                param[i] = saved - h;
+                double down = ref.loss(X, labels);
+                param[i] = saved;
+                numeric[i] = (up - down) / (2.0 * h);
+            }
+            compare(name + (which ? " dB" : " dW") + std::to_string(l), grad, grad.rows,
+                    grad.cols, numeric, {0, 1e-3, 1e-5});
+        }
+    }
+
+    // one SGD step: W - (lr * dW), each rounded to float like the kernels do
+    std::vector<std::vector<double>> expected;
+    for (size_t l = 0; l < net.weights.size(); l++) {
+        std::vector<double> w(net.weights[l]->size());
+        for (size_t i = 0; i < w.size(); i++)
+            w[i] = (float)((double)net.weights[l]->h_data[i] -
+                           (float)((double)grads.dW[l]->h_data[i] * net.learningRate));
+        expected.push_back(std::move(w));
+    }
+    update_params(&net, grads);
+    for (size_t l = 0; l < net.weights.size(); l++)
+        compare("update_params W" + std::to_string(l), *net.weights[l], net.weights[l]->rows,
+                net.weights[l]->cols, expected[l], EXACT);
+}
+
+void test_inference_model(const std::vector<int>& layers) {
+    NeuralNetwork net(layers, 0.1f);
+    randomize_net(net);
+    RefNet ref(net);
+
+    const int max_batch = 8;
+    auto model = Freeze(&net, max_batch, 1);
+    // below, at and above max_batch (chunked), and not a multiple of the tile width
+    for (int batch : {1, 3, max_batch, 2 * max_batch + 5}) {
+        Tensor x = random_tensor(batch, layers.front(), 0.0f, 1.0f);  // sample-major
+        Tensor y(batch, layers.back());
+        model->run(x.h_data, batch, y.h_data);
+
+        std::vector<double> probs;
+        for (int s = 0; s < batch; s++) {
+            std::vector<double> in(x.h_data + (size_t)s * layers.front(),
+                                   x.h_data + (size_t)(s + 1) * layers.front());
+            auto p = ref.forward(in);
+            probs.insert(probs.end(), p.begin(), p.end());
+        }
+        std::string name = "InferenceModel::run";
+        for (int n : layers) name += " " + std::to_string(n);
+        compare(name + " batch " + std::to_string(batch), y, batch, layers.back(), probs,
+                {16, 1e-4, 1e-6});
+    }
+}
+
+// tensors that disagree with the layer sizes must be refused, not packed out of bounds
+void test_shape_validation() {
+    const std::vector<int> layers = {5, 17, 3};
+    NeuralNetwork net(layers, 0.1f);
+    randomize_net(net);
+    check(Freeze(&net, 4, 1) != nullptr, "Freeze accepts a well-formed network");
+
+    auto good = std::move(net.weights[0]);
+    net.weights[0] = std::make_unique<Tensor>(layers[0], layers[1]);  // transposed
+    check(!Freeze(&net, 4, 1), "Freeze rejects transposed weights");
+    net.weights[0] = std::make_unique<Tensor>(layers[1], layers[0] - 1);
+    check(!Freeze(&net, 4, 1), "Freeze rejects weights short of the input size");
+    net.weights[0] = std::move(good);
+    net.biases[1] = std::make_unique<Tensor>(layers[2] + 1, 1);
+    check(!Freeze(&net, 4, 1), "Freeze rejects oversized biases");
+    net.biases[1] = std::make_unique<Tensor>(layers[2], 1);
+
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("test_tensor_" + std::to_string(g_seed));
+    fs::remove_all(dir);
+    if (!check(save(&net, dir.string(), false), "save the network for load")) return;
+    std::unique_ptr<NeuralNetwork> loaded(load(dir.string()));
+    check(loaded && !!Freeze(loaded.get(), 4, 1), "load accepts matching CSVs");
+    ModelWatcher watcher(dir.string());
+    check(watcher.reload(), "ModelWatcher loads the matching model");
+    auto served = watcher.current();
+    std::unique_ptr<SparseNetwork> sparse(load_sparse(dir.string()));
+    check(sparse && sparse->weights.size() == 2, "load_sparse accepts matching CSVs");
+
+    // a descriptor that claims a wider hidden layer than the CSVs hold
+    std::ofstream(dir / "descriptor.txt") << "3\n5\n18\n3\n0.1\n";
+    loaded.reset(load(dir.string()));
+    check(!loaded, "load rejects CSVs that disagree with the descriptor");
+    check(!watcher.reload() && watcher.rejected() == 1 && watcher.current() == served,
+          "ModelWatcher rejects the mismatched model and keeps the current one");
+    sparse.reset(load_sparse(dir.string()));
+    check(!sparse, "load_sparse rejects CSVs that disagree with the descriptor");
+
+    for (const char* desc : {"-4\n", "1\n5\n0.1\n", "3\n5\n0\n3\n0.1\n"}) {
+        std::ofstream(dir / "descriptor.txt") << desc;
+        loaded.reset(load(dir.string()));
+        sparse.reset(load_sparse(dir.string()));
+        check(!loaded && !sparse, "load and load_sparse reject a malformed descriptor");
+    }
+
+    std::ofstream(dir / "descriptor.txt") << "3\n5\n17\n3\n0.1\n";
+    std::ofstream(dir / "biases_1.csv") << "4,1\n0\n0\n0\n0\n";
+    sparse.reset(load_sparse(dir.string()));
+    check(!sparse, "load_sparse rejects biases of the wrong shape");
+    fs::remove_all(dir);
+}
+
+// big-endian u32 header fields followed by the payload bytes
+void write_idx(const std::string& path, const std::vector<uint32_t>& header,
+               const std::vector<uint8_t>& data) {
+    std::ofstream f(path, std::ios::binary);
+    for (uint32_t v : header) {
+        unsigned char be[4] = {(unsigned char)(v >> 24), (unsigned char)(v >> 16),
+                               (unsigned char)(v >> 8), (unsigned char)v};
+        f.write(reinterpret_cast<const char*>(be), 4);
+    }
+    f.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+// a tiny IDX pair: header validation, then the normalized batches the trainer stacks
+void test_idx_dataset() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("test_idx_" + std::to_string(g_seed));
+    fs::create_directories(dir);
+    std::string images = (dir / "images").string(), labels = (dir / "labels").string();
+    std::string bad = (dir / "bad").string();
+
+    const int count = 5, rows = 3, cols = 4, pixels = rows * cols;
+    std::vector<uint8_t> px(count * pixels), lbl(count);
+    for (auto& v : px) v = rng() % 256;
+    for (auto& v : lbl) v = rng() % 10;
+    px[0] = 0;
+    px[1] = 255;
+    write_idx(images, {0x803, count, rows, cols}, px);
+    write_idx(labels, {0x801, count}, lbl);
+
+    auto idx = IdxDataset::open(images, labels);
+    if (!check(idx && idx->size() == count && idx->rows() == rows && idx->cols() == cols,
+               "IdxDataset::open reads the header"))
+        return;
+
+    // batch of samples 3, 0, 4 of the copy main trains on: pixels x batch, px / 255
+    std::vector<int> order = {2, 3, 0, 4};
+    auto all = Dataset::from_idx(*idx, count);
+    auto X = stack_batch_inputs(*all, order, 1, 3);
+    auto Y = stack_batch_labels(*all, order, 1, 3);
+    std::vector<double> want_x((size_t)pixels * 3), want_y(10 * 3);
+    for (int b = 0; b < 3; b++) {
+        int i = order[1 + b];
+        for (int k = 0; k < pixels; k++)
+            want_x[(size_t)k * 3 + b] = (float)(px[i * pixels + k] / 255.0f);
+        want_y[lbl[i] * 3 + b] = 1.0;
+    }
+    compare("stack_batch_inputs from_idx", *X, pixels, 3, want_x, EXACT);
+    compare("stack_batch_labels from_idx", *Y, 10, 3, want_y, EXACT);
+
+    // every other row of the first four, as rank 1 of 2 would train on
+    auto shard = Dataset::from_idx(*idx, 4, 1, 2);
+    check(shard->size() == 2 && shard->label(0) == lbl[1] && shard->label(1) == lbl[3] &&
+              std::memcmp(shard->image(1), px.data() + 3 * pixels, pixels) == 0,
+          "Dataset::from_idx keeps the shard's rows");
+
+    auto rejects = [&](const std::vector<uint32_t>& header, size_t payload, bool as_images,
+                       const std::string& what) {
+        write_idx(bad, header, std::vector<uint8_t>(payload));
+        auto ds = as_images ? IdxDataset::open(bad, labels) : IdxDataset::open(images, bad);
+        check(!ds, "IdxDataset::open rejects " + what);
+    };
+    rejects({0x801, count, rows, cols}, px.size(), true, "a label magic on images");
+    rejects({0x803, count, rows, cols}, px.size() - 1, true, "truncated images");
+    rejects({0x803, count, 0, cols}, 0, true, "zero-sized images");
+    rejects({0x803, count}, lbl.size(), false, "an image magic on labels");
+    rejects({0x801, count - 1}, lbl.size() - 1, false, "a label count mismatch");
+    rejects({0x801, count}, lbl.size() + 1, false, "trailing label bytes");
+    write_idx(bad, {0x801, count}, std::vector<uint8_t>(count, 10));
+    check(!IdxDataset::open(images, bad), "IdxDataset::open rejects labels above 9");
+
+    fs::remove_all(dir);
+}
+
+// CSR files whose row pointers would send the kernels outside col_idx / values
+void test_sparse_file() {
+    namespace fs = std::filesystem;
+    std::string path =
+        (fs::temp_directory_path() / ("test_sparse_" + std::to_string(g_seed))).string();
+    Filer filer;
+
+    SparseTensor t;
+    t.rows = 3;
+    t.cols = 4;
+    t.col_idx = {0, 3, 1};
+    t.values = {1.0f, 2.0f, 3.0f};
+
+    auto loads = [&](const std::vector<int32_t>& row_ptr) {
+        t.row_ptr = row_ptr;
+        filer.save_sparse_tensor(&t, path);
+        return filer.load_sparse_tensor(path) != nullptr;
+    };
+    check(loads({0, 2, 2, 3}), "load_sparse_tensor accepts valid row pointers");
+    check(!loads({1, 2, 2, 3}), "load_sparse_tensor rejects row_ptr[0] != 0");
+    check(!loads({0, 3, 2, 3}), "load_sparse_tensor rejects decreasing row pointers");
+    check(!loads({0, 2, 5, 3}), "load_sparse_tensor rejects row pointers past nnz");
+    check(!loads({0, 2, 2, 2}), "load_sparse_tensor rejects row_ptr.back() != nnz");
+    fs::remove(path);
+}
+
+// save_factorized / load_factorized round trip with one factorized and one dense layer
+void test_factorized_file() {
+    NeuralNetwork net({5, 17, 3}, 0.1f);
+    randomize_net(net);
+    std::vector<LayerSpectrum> spectra;
+    for (const auto& w : net.weights) spectra.push_back(Tspectrum(*w));
+
+    bool threw = false;
+    try {
+        delete Factorize(&net, spectra, {2});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "Factorize rejects a rank list shorter than the layers");
+
+    std::unique_ptr<FactorizedNetwork> fn(Factorize(&net, spectra, {2, 0}));
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / ("test_lowrank_" + std::to_string(g_seed));
+    fs::remove_all(dir);
+    save_factorized(fn.get(), dir.string());
+
+    std::unique_ptr<FactorizedNetwork> loaded(load_factorized(dir.string()));
+    if (!check(loaded && loaded->weights.size() == 2 && loaded->weights[0].rank() == 2 &&
+                   !loaded->weights[1].is_factorized(),
+               "load_factorized reads the saved layers back"))
+        return;
+    Tensor x(5, 1);
+    for (int i = 0; i < x.size(); i++) x.h_data[i] = std::uniform_real_distribution<float>()(rng);
+    auto want = predict(fn.get(), &x);
+    compare("factorized predict after save / load", *predict(loaded.get(), &x), want->rows,
+            want->cols, std::vector<double>(want->h_data, want->h_data + want->size()),
+            Tolerance{0, 0.0, 1e-4});
+
+    std::ofstream(dir / "descriptor.txt") << "-4\n";
+    loaded.reset(load_factorized(dir.string()));
+    check(!loaded, "load_factorized rejects a malformed descriptor");
+    std::ofstream(dir / "descriptor.txt") << "3\n5\n17\n3\n0.1\n";
+    std::ofstream(dir / "biases_0.csv") << "4,1\n0\n0\n0\n0\n";
+    loaded.reset(load_factorized(dir.string()));
+    check(!loaded, "load_factorized rejects biases of the wrong shape");
+    fs::remove_all(dir);
+}
+
+// a part that throws reaches collect() instead of leaving it waiting for the batch
+void test_augment_failure() {
+    AugmentOptions opts;
+    opts.threads = 2;
+    Augmenter augmenter(opts);
+    std::vector<int> order = {0, 1, 2, 3};
+
+    Dataset large(65, 65);  // above the augmenter's scratch size
+    std::vector<uint8_t> px(large.pixels());
+    for (int i = 0; i < 4; i++) large.add(px.data(), i);
+    bool threw = false;
+    try {
+        augmenter.stack(large, order, 0, 4, 0);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "Augmenter::stack rethrows a failed part");
+
+    Dataset small(28, 28);
+    px.resize(small.pixels());
+    for (int i = 0; i < 4; i++) small.add(px.data(), i);
+    auto X = augmenter.stack(small, order, 0, 4, 0);
+    check(X && X->rows == small.pixels() && X->cols == 4, "Augmenter keeps working after it");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int shapes = 40;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            g_seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--shapes" && i + 1 < argc) {
+            shapes = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "usage: test_tensor [--seed N] [--shapes N]\n";
+            return 1;
+        }
+    }
+    rng.seed(g_seed);
+
+    for (int n : EDGE_SIZES) {
+        test_elementwise(n, 1);
+        test_elementwise(1, n);
+        test_vectors(n);
+    }
+    for (int i = 0; i < shapes; i++) {
+        test_elementwise(random_size(), random_size());
+        test_matmul(random_size(), random_size(), random_size(64));
+        test_randomize(random_size(), random_size());
+    }
+    // the network's own shapes: forward, dW and dA products
+    test_matmul(512, 784, 64);
+    test_matmul(512, 64, 784);
+    test_matmul(256, 512, 64);
+    test_matmul(10, 256, 1);
+    test_validation();
+
+    test_gradients({6, 9, 5, 4}, 7);
+    test_gradients({13, 17, 3}, 1);
+    test_gradients({2, 31, 16, 10}, 16);
+
+    test_inference_model({784, 512, 256, 10});
+    test_inference_model({5, 17, 3});
+    test_inference_model({33, 1, 2});
+    test_shape_validation();
+    test_idx_dataset();
+    test_sparse_file();
+    test_factorized_file();
+    test_augment_failure();
+
+    std::cout << g_checks - g_failures << " / " << g_checks << " checks passed (seed " << g_seed
+              << ")\n";
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+// Converts between the CSV model directory written by save() and the single-file binary
+// format of Infer/model_file.h.
+//
+//   convert_model <model_dir> <model.mnm>            CSV directory -> binary
+//   convert_model --to-csv <model.mnm> <model_dir>   binary -> CSV directory
+//
+// After converting to binary the file is mapped again and run against the CSV model on a
+// random input, so a broken file is caught right away.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Infer/model_file.h"
+#include "NN/neural_network.h"
+
+static int to_binary(const std::string& dir, const std::string& path) {
+    std::unique_ptr<NeuralNetwork> net(load(dir));
+    if (!net) return 1;
+    if (!save_model_file(net.get(), path)) return 1;
+
+    auto start = std::chrono::steady_clock::now();
+    auto model = open_model_file(path, 1, 1);
+    double open_us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    if (!model) return 1;
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    Tensor x(model->input_size(), 1);
+    for (int i = 0; i < x.size(); i++) x.h_data[i] = dist(rng);
+
+    auto expected = predict(net.get(), &x);
+    std::vector<float> probs(model->output_size());
+    model->run(x.h_data, 1, probs.data());
+
+    float max_diff = 0.0f;
+    for (int c = 0; c < model->output_size(); c++)
+        max_diff = std::max(max_diff, std::abs(probs[c] - expected->h_data[c]));
+
+    std::cout << "Wrote " << path << " (opened in " << open_us << " us, max diff " << max_diff
+              << ")\n";
+    return max_diff < 1e-4f ? 0 : 1;
+}
+
+static int to_csv(const std::string& path, const std::string& dir) {
+    std::unique_ptr<NeuralNetwork> net(load_model_file(path));
+    if (!net) return 1;
+    return save(net.get(), dir) ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 4 && std::string(argv[1]) == "--to-csv") return to_csv(argv[2], argv[3]);
+    if (argc == 3) return to_binary(argv[1], argv[2]);
+
+    std::cerr << "usage: convert_model <model_dir> <model.mnm>\n"
+                 "       convert_model --to-csv <model.mnm> <model_dir>\n";
+    return 1;
+}
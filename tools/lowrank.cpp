@@ -0,0 +1,173 @@
+// Offline low-rank factorization of a trained model.
+//
+//   lowrank <model_dir> <val_csv> [--samples N] [--ranks 16,32,64] [--energies 0.9,0.99]
+//           [--out DIR (--rank R | --energy E)]
+//
+// Loads the model with load(), computes the singular spectrum of every weight matrix once,
+// then sweeps fixed ranks and energy thresholds and prints FLOPs, latency and accuracy for
+// each setting. With --out the selected setting is written with save_factorized(), read back
+// with load_factorized() and checked against the network in memory.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Filer.h"
+#include "NN/low_rank.h"
+
+static std::vector<float> parse_list(const std::string& s) {
+    std::vector<float> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) out.push_back(std::stof(item));
+    return out;
+}
+
+template <typename Net>
+static double latency_us(Net* net, std::vector<Filer::Img>& dataset, int n) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        auto img = Tflatten(*dataset[i].img_data);
+        predict(net, img.get());
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / n;
+}
+
+static std::string rank_list(const FactorizedNetwork* net) {
+    std::string s;
+    for (const auto& l : net->weights) {
+        if (!s.empty()) s += "/";
+        s += l.is_factorized() ? std::to_string(l.rank()) : "full";
+    }
+    return s;
+}
+
+static void print_row(const std::string& setting, FactorizedNetwork* net,
+                      std::vector<Filer::Img>& val, int n) {
+    float acc = evaluate_accuracy(net, val, n);
+    double us = latency_us(net, val, n);
+    std::printf("%-14s %-18s %10.3f %12.1f %9.4f\n", setting.c_str(), rank_list(net).c_str(),
+                net->flops() / 1e6, us, acc);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: lowrank <model_dir> <val_csv> [--samples N] [--ranks r1,r2,..]\n"
+                     "               [--energies e1,e2,..] [--out DIR (--rank R | --energy E)]\n";
+        return 1;
+    }
+
+    std::string model_dir = argv[1];
+    std::string val_csv = argv[2];
+    int samples = 1000;
+    std::vector<float> ranks = {8, 16, 32, 64, 128};
+    std::vector<float> energies = {0.8f, 0.9f, 0.95f, 0.99f};
+    std::string out_dir;
+    int out_rank = 0;
+    float out_energy = 0.0f;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--samples") {
+            samples = std::stoi(value);
+        } else if (flag == "--ranks") {
+            ranks = parse_list(value);
+        } else if (flag == "--energies") {
+            energies = parse_list(value);
+        } else if (flag == "--out") {
+            out_dir = value;
+        } else if (flag == "--rank") {
+            out_rank = std::stoi(value);
+        } else if (flag == "--energy") {
+            out_energy = std::stof(value);
+        } else {
+            std::cerr << "Unknown flag " << flag << "\n";
+            return 1;
+        }
+    }
+
+    std::unique_ptr<NeuralNetwork> net(load(model_dir));
+    if (!net) return 1;
+
+    Filer filer;
+    auto val = filer.get_data(val_csv, samples);
+    if (val.empty()) return 1;
+    int n = val.size();
+
+    std::vector<LayerSpectrum> spectra;
+    for (const auto& w : net->weights) {
+        auto t0 = std::chrono::steady_clock::now();
+        spectra.push_back(Tspectrum(*w));
+        auto t1 = std::chrono::steady_clock::now();
+        std::cout << "SVD " << w->rows << "x" << w->cols << ": "
+                  << std::chrono::duration<double>(t1 - t0).count() << " s, break-even rank "
+                  << break_even_rank(w->rows, w->cols) << "\n";
+    }
+
+    int L = net->weights.size();
+    std::printf("\n%-14s %-18s %10s %12s %9s\n", "setting", "ranks", "MFLOP", "latency_us",
+                "accuracy");
+
+    {
+        std::unique_ptr<FactorizedNetwork> dense(Factorize(net.get(), spectra, std::vector<int>(L)));
+        print_row("dense", dense.get(), val, n);
+    }
+
+    for (float r : ranks) {
+        std::unique_ptr<FactorizedNetwork> fn(
+            Factorize(net.get(), spectra, std::vector<int>(L, (int)r)));
+        print_row("rank=" + std::to_string((int)r), fn.get(), val, n);
+    }
+
+    auto energy_ranks = [&](float energy) {
+        std::vector<int> r(L);
+        for (int i = 0; i < L; i++) r[i] = rank_for_energy(spectra[i], energy);
+        return r;
+    };
+
+    for (float e : energies) {
+        std::unique_ptr<FactorizedNetwork> fn(Factorize(net.get(), spectra, energy_ranks(e)));
+        char label[32];
+        std::snprintf(label, sizeof(label), "energy=%.3g", e);
+        print_row(label, fn.get(), val, n);
+    }
+
+    if (!out_dir.empty()) {
+        if (out_rank <= 0 && out_energy <= 0.0f) {
+            std::cerr << "--out needs --rank or --energy\n";
+            return 1;
+        }
+        auto r = out_rank > 0 ? std::vector<int>(L, out_rank) : energy_ranks(out_energy);
+        std::unique_ptr<FactorizedNetwork> fn(Factorize(net.get(), spectra, r));
+        save_factorized(fn.get(), out_dir);
+
+        // read the saved model back; it has to run as it did in memory
+        std::unique_ptr<FactorizedNetwork> saved(load_factorized(out_dir));
+        if (!saved) return 1;
+        float max_diff = 0.0f;
+        for (int i = 0; i < n; i++) {
+            auto img = Tflatten(*val[i].img_data);
+            auto a = predict(fn.get(), img.get());
+            auto b = predict(saved.get(), img.get());
+            for (int j = 0; j < a->size(); j++)
+                max_diff = std::max(max_diff, std::fabs(a->h_data[j] - b->h_data[j]));
+        }
+        float acc = evaluate_accuracy(fn.get(), val, n);
+        float saved_acc = evaluate_accuracy(saved.get(), val, n);
+        std::printf("Reloaded %s: ranks %s, accuracy %.4f (in memory %.4f), max diff %g\n",
+                    out_dir.c_str(), rank_list(saved.get()).c_str(), saved_acc, acc, max_diff);
+        if (rank_list(saved.get()) != rank_list(fn.get()) || max_diff > 1e-3f) {
+            std::cerr << "Saved model does not match the factorized network\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Long-running prediction server: the model is loaded once and requests are answered over a
+// Unix-domain socket and / or a local HTTP port (see Server/server.h for the protocols).
+//
+//   mnist_server --model <model.mnm | model_dir> [--socket PATH] [--port N] [--workers N]
+//                [--watch]
+//
+// With neither --socket nor --port the server listens on /tmp/mnist.sock. SIGINT / SIGTERM
+// stop it cleanly. --watch reloads the model whenever it changes on disk (see
+// Infer/model_watcher.h); requests are served by the old model until the new one has loaded
+// and passed validation.
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "Infer/model_watcher.h"
+#include "Server/server.h"
+
+static PredictServer* g_server = nullptr;
+
+static void on_signal(int) {
+    if (g_server) g_server->stop();
+}
+
+int main(int argc, char* argv[]) {
+    std::string model_path;
+    ServerOptions opts;
+    bool watch = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--model" && has_value) {
+            model_path = argv[++i];
+        } else if (arg == "--socket" && has_value) {
+            opts.socket_path = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            opts.http_port = std::atoi(argv[++i]);
+        } else if (arg == "--workers" && has_value) {
+            opts.workers = std::atoi(argv[++i]);
+        } else if (arg == "--watch") {
+            watch = true;
+        } else {
+            std::cerr << "usage: mnist_server --model <model.mnm | model_dir> [--socket PATH] "
+                         "[--port N] [--workers N] [--watch]\n";
+            return 1;
+        }
+    }
+    if (model_path.empty()) {
+        std::cerr << "mnist_server: --model is required\n";
+        return 1;
+    }
+    if (opts.socket_path.empty() && opts.http_port <= 0) opts.socket_path = "/tmp/mnist.sock";
+
+    std::shared_ptr<const InferenceModel> model;
+    std::unique_ptr<ModelWatcher> watcher;
+    if (watch) {
+        WatchOptions wopts;
+        wopts.max_threads = opts.workers;
+        watcher = std::make_unique<ModelWatcher>(model_path, wopts);
+        if (!watcher->start()) return 1;
+        model = watcher->current();
+    } else {
+        model = open_model(model_path, 256, opts.workers);
+        if (!model) return 1;
+    }
+
+    PredictServer server(model, opts);
+    if (!server.start()) return 1;
+    if (watcher) watcher->on_reload([&](auto next) { server.set_model(std::move(next)); });
+
+    g_server = &server;
+    struct sigaction sa {};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Serving " << model_path;
+    if (!opts.socket_path.empty()) std::cout << " on " << opts.socket_path;
+    if (opts.http_port > 0) std::cout << " on http://127.0.0.1:" << opts.http_port;
+    std::cout << std::endl;
+
+    server.run();
+    g_server = nullptr;
+    if (watcher) watcher->on_reload(nullptr);
+
+    std::cout << "Stopped after " << server.requests() << " requests" << std::endl;
+    return 0;
+}